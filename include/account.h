@@ -27,6 +27,11 @@ struct kline_ {
   char *reason;
   char *setby;
 
+  hostmatch_t *usermatcher;
+  hostmatch_t *hostmatcher;
+  mowgli_node_t inode; /* for the host index, see kline_find_user() */
+  kline_t *numnext; /* for the number hash, see kline_find_num() */
+
   unsigned long number;
   long duration;
   time_t settime;
@@ -62,6 +67,7 @@ struct svsignore_ {
   svsignore_t *svsignore;
 
   char *mask;
+  hostmatch_t *matcher;
   time_t settime;
   char *setby;
   char *reason;
@@ -75,6 +81,7 @@ struct myuser_
 
   stringref email;
   stringref email_canonical;
+  mowgli_node_t email_node; /* for the canonical email index */
 
   mowgli_list_t logins; /* user_t's currently logged in to this */
   time_t registered;
@@ -96,6 +103,12 @@ struct myuser_
   language_t *language;
 
   mowgli_list_t cert_fingerprints;
+
+  /* memos, memo ignores, access list and metadata which are still in the
+   * database, see myuser_load_cold(); cold_len is 0 once they are loaded
+   */
+  off_t cold_offset;
+  size_t cold_len;
 };
 
 /* Keep this synchronized with mu_flags in libathemecore/flags.c */
@@ -171,6 +184,8 @@ struct mychan_
   char *mlock_key;
 
   unsigned int flags;
+
+  unsigned int chanacs_gen; /* see chanacs_user_flags() */
 };
 
 /* Keep this synchronized with mc_flags in libathemecore/flags.c */
@@ -205,6 +220,7 @@ struct chanacs_
 	myentity_t *entity;
 	mychan_t *mychan;
 	char     *host;
+	hostmatch_t *matcher;
 	unsigned int  level;
 	time_t    tmodified;
 
@@ -419,6 +435,8 @@ E void myuser_delete(myuser_t *mu);
 //inline myuser_t *myuser_find(const char *name);
 E void myuser_rename(myuser_t *mu, const char *name);
 E void myuser_set_email(myuser_t *mu, const char *newemail);
+E void myuser_canonicalize_email(myuser_t *mu);
+E mowgli_list_t *myuser_find_email(const char *email);
 E myuser_t *myuser_find_ext(const char *name);
 E void myuser_notice(const char *from, myuser_t *target, const char *fmt, ...) PRINTFLIKE(3, 4);
 
@@ -464,6 +482,9 @@ E chanacs_t *chanacs_find_host_by_user(mychan_t *mychan, user_t *u, unsigned int
 E chanacs_t *chanacs_find_by_mask(mychan_t *mychan, const char *mask, unsigned int level);
 E bool chanacs_user_has_flag(mychan_t *mychan, user_t *u, unsigned int level);
 E unsigned int chanacs_user_flags(mychan_t *mychan, user_t *u);
+E void chanacs_cache_invalidate_user(user_t *u);
+E void chanacs_cache_invalidate_channel(mychan_t *mc);
+E void chanacs_cache_invalidate_all(void);
 //inline bool chanacs_source_has_flag(mychan_t *mychan, sourceinfo_t *si, unsigned int level);
 E unsigned int chanacs_source_flags(mychan_t *mychan, sourceinfo_t *si);
 
@@ -476,6 +497,10 @@ E bool chanacs_modify_simple(chanacs_t *ca, unsigned int addflags, unsigned int
 
 E bool chanacs_change(mychan_t *mychan, myentity_t *mt, const char *hostmask, unsigned int *addflags, unsigned int *removeflags, unsigned int restrictflags, myentity_t *setter);
 E bool chanacs_change_simple(mychan_t *mychan, myentity_t *mt, const char *hostmask, unsigned int addflags, unsigned int removeflags, myentity_t *setter);
+E const char *metadata_db_type(void *target);
+E bool myuser_cold_loading;
+E void myuser_load_cold(myuser_t *mu);
+E bool myuser_metadata_is_hot(const char *name);
 
 E void expire_check(void *arg);
 /* Check the database for (version) problems common to all backends */
@@ -33,6 +33,14 @@ struct channel_
   mowgli_list_t members;
   mowgli_list_t bans;
 
+  /* members by user, for large channels; see chanuser_find() */
+  chanuser_t **memberhash;
+  unsigned int memberhashsize;
+
+  /* bans by type; see chanban_first() */
+  chanbanlist_t *banlists;
+  unsigned int numbanlists;
+
   unsigned int flags;
 
   mychan_t *mychan;
@@ -46,6 +54,12 @@ struct chanuser_
   unsigned int modes;
   mowgli_node_t unode;
   mowgli_node_t cnode;
+
+  /* cached chanacs_user_flags() result */
+  myuser_t *acs_mu;
+  unsigned int acs_gen;
+  unsigned int acs_flags;
+  unsigned int acs_hostflags;
 };
 
 struct chanban_
@@ -54,7 +68,17 @@ struct chanban_
   char *mask;
   int type; /* 'b', 'e', 'I', etc -- jilles */
   mowgli_node_t node; /* for channel_t.bans */
+  mowgli_node_t tnode; /* for chanbanlist_t.bans */
   unsigned int flags;
+  hostmatch_t *matcher;
+};
+
+/* the bans of one type on a channel */
+struct chanbanlist_
+{
+  int type;
+  mowgli_list_t bans;
+  mowgli_patricia_t *masks; /* by mask, once the list gets long */
 };
 
 /* channel_t.modes */
@@ -179,6 +203,7 @@ E chanuser_t *chanuser_find(channel_t *chan, user_t *user);
 E chanban_t *chanban_add(channel_t *chan, const char *mask, int type);
 E void chanban_delete(chanban_t *c);
 E chanban_t *chanban_find(channel_t *chan, const char *mask, int type);
+E mowgli_node_t *chanban_first(channel_t *chan, int type);
 //inline void chanban_clear(channel_t *chan);
 
 #endif
@@ -100,6 +100,7 @@ typedef struct server_ server_t;
 typedef struct channel_ channel_t;
 typedef struct chanuser_ chanuser_t;
 typedef struct chanban_ chanban_t;
+typedef struct chanbanlist_ chanbanlist_t;
 
 typedef struct operclass_ operclass_t;
 typedef struct soper_ soper_t;
@@ -111,6 +112,9 @@ typedef struct service_ service_t;
 
 typedef struct sourceinfo_ sourceinfo_t;
 
+typedef struct hostmatch_ hostmatch_t;
+typedef struct cidrtree_ cidrtree_t;
+
 enum faultcode_
 {
 	fault_needmoreparams	= 1,
@@ -163,8 +167,10 @@ typedef const char *stringref;
 
 void strshare_init(void);
 stringref strshare_get(const char *str);
+stringref strshare_get_len(const char *str, size_t len);
 stringref strshare_ref(stringref str);
 void strshare_unref(stringref str);
+size_t strshare_len(stringref str);
 
 #endif
 
@@ -19,6 +19,7 @@ E void init_newconf(void);
 E mowgli_list_t conf_si_table; /* serverinfo{} */
 E mowgli_list_t conf_gi_table; /* general{} */
 E mowgli_list_t conf_la_table; /* language{} */
+E mowgli_list_t conf_db_table; /* database{} */
 
 #endif
 
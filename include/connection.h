@@ -37,7 +37,10 @@ struct connection_
 	char name[HOSTLEN];
 	char hbuf[BUFSIZE + 1];
 
-	mowgli_list_t recvq;
+	char *recvq;			/* ring buffer, see datastream.c */
+	size_t recvq_head;
+	size_t recvq_len;
+
 	mowgli_list_t sendq;
 
 	int fd;
@@ -47,6 +50,11 @@ struct connection_
 	time_t last_recv;
 
 	size_t sendq_limit;
+	size_t sendq_len;		/* bytes waiting in sendq */
+	size_t sendq_peak;		/* most bytes ever waiting */
+	unsigned long sendq_queued;	/* bytes ever added to sendq */
+	unsigned long sendq_syscalls;	/* writes made to flush it */
+	unsigned int sendq_corked;	/* see sendq_cork() */
 
 	sockaddr_any_t saddr;
 	socklen_t saddr_size;
@@ -11,6 +11,9 @@
 #include "common.h"
 
 E bool strict_mode;
+E bool db_full_load;
+E unsigned int db_rows_read;
+E unsigned int db_rows_written;
 
 struct database_handle_;
 typedef struct database_handle_ database_handle_t;
@@ -35,6 +38,10 @@ typedef struct {
 	bool (*write_uint)(database_handle_t *hdl, unsigned int num);
 	bool (*write_time)(database_handle_t *hdl, time_t time);
 	bool (*commit_row)(database_handle_t *hdl);
+
+	/* Sectioned databases, see db_start_cold(). */
+	bool (*start_cold)(database_handle_t *hdl, myuser_t *mu);
+	void (*end_cold)(database_handle_t *hdl);
 } database_vtable_t;
 
 typedef enum {
@@ -53,12 +60,13 @@ struct database_handle_ {
 
 typedef struct {
 	database_handle_t *(*db_open)(const char *filename, database_transaction_t txn);
-	void (*db_close)(database_handle_t *db);
+	bool (*db_close)(database_handle_t *db);
 	void (*db_parse)(database_handle_t *db);
+	void (*db_load_cold)(myuser_t *mu, off_t offset, size_t len);
 } database_module_t;
 
 E database_handle_t *db_open(const char *filename, database_transaction_t txn);
-E void db_close(database_handle_t *db);
+E bool db_close(database_handle_t *db);
 E void db_parse(database_handle_t *db);
 
 E bool db_read_next_row(database_handle_t *db);
@@ -84,11 +92,27 @@ E bool db_write_time(database_handle_t *db, time_t time);
 E bool db_write_format(database_handle_t *db, const char *str, ...);
 E bool db_commit_row(database_handle_t *db);
 
+E bool db_start_cold(database_handle_t *db, myuser_t *mu);
+E void db_end_cold(database_handle_t *db);
+
 typedef void (*database_handler_f)(database_handle_t *db, const char *type);
 
+typedef struct {
+	char *name;
+	unsigned int id;
+	database_handler_f fun;
+
+	/* load statistics, see db_log_stats() */
+	unsigned int rows;
+	struct timeval time;
+} database_type_t;
+
 E void db_register_type_handler(const char *type, database_handler_f fun);
 E void db_unregister_type_handler(const char *type);
+E unsigned int db_type_id(const char *type);
 E void db_process(database_handle_t *db, const char *type);
+E void db_process_id(database_handle_t *db, unsigned int id, const char *type);
+E void db_log_stats(database_handle_t *db);
 E void db_init(void);
 E database_module_t *db_mod;
 
@@ -10,7 +10,11 @@
 #define ATHEME_DATASTREAM_H
 
 E void sendq_add(connection_t *cptr, char *buf, size_t len);
+E char *sendq_reserve(connection_t *cptr, size_t len);
+E void sendq_commit(connection_t *cptr, size_t len);
 E void sendq_add_eof(connection_t *cptr);
+E void sendq_cork(connection_t *cptr);
+E void sendq_uncork(connection_t *cptr);
 E void sendq_flush(connection_t *cptr);
 E bool sendq_nonempty(connection_t *cptr);
 E void sendq_set_limit(connection_t *cptr, size_t len);
@@ -19,6 +23,7 @@ E int recvq_length(connection_t *cptr);
 E void recvq_put(connection_t *cptr);
 E int recvq_get(connection_t *cptr, char *buf, size_t len);
 E int recvq_getline(connection_t *cptr, char *buf, size_t len);
+E int recvq_getline_inplace(connection_t *cptr, char **line, size_t len);
 
 E void sendqrecvq_free(connection_t *cptr);
 
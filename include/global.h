@@ -113,6 +113,8 @@ struct ConfOption
   unsigned int immune_level;	/* what flag is required for kick immunity */
 
   bool show_entity_id;		/* do not require user:auspex to see entity IDs */
+
+  unsigned int member_hash_threshold;	/* members from which a channel gets a membership hash */
 };
 
 E struct ConfOption config_options;
@@ -142,6 +144,11 @@ struct cnt
   unsigned int operclass;
   unsigned int myuser_access;
   unsigned int myuser_name;
+  unsigned int chanacs_cache_hit;
+  unsigned int chanacs_cache_miss;
+  unsigned int strshare;
+  unsigned int strshare_refs;
+  size_t strshare_bytes;
 };
 
 E struct cnt cnt;
@@ -13,6 +13,25 @@
 /* cidr.c */
 E int match_ips(const char *mask, const char *address);
 E int match_cidr(const char *mask, const char *address);
+E int cidr_parse(const char *s, unsigned char *addr, bool *v6);
+E int cidr_match(const unsigned char *addr, int cidrlen, bool v6, const char *s);
+E int cidr_parse_ip(const char *s, unsigned char *addr, bool *v6);
+
+/* cidrtree.c */
+E cidrtree_t *cidrtree_create(void);
+E void cidrtree_destroy(cidrtree_t *tree);
+E bool cidrtree_add(cidrtree_t *tree, const char *mask, void *data);
+E void *cidrtree_find(cidrtree_t *tree, const char *mask);
+E void *cidrtree_delete(cidrtree_t *tree, const char *mask);
+E void *cidrtree_search(cidrtree_t *tree, const char *address);
+E void *cidrtree_search_all(cidrtree_t *tree, const char *address, void *(*cb)(void *data, void *privdata), void *privdata);
+
+/* hostmatch.c */
+E hostmatch_t *hostmatch_create(const char *mask);
+E void hostmatch_destroy(hostmatch_t *hm);
+E int hostmatch(const hostmatch_t *hm, const char *name);
+E int hostmatch_cidr(const hostmatch_t *hm, const char *address);
+E int hostmatch_ips(const hostmatch_t *hm, const char *address);
 
 /* match.c */
 #define MATCH_RFC1459   0
@@ -64,7 +83,7 @@ typedef struct atheme_regex_ atheme_regex_t;
 
 E atheme_regex_t *regex_create(char *pattern, int flags);
 E char *regex_extract(char *pattern, char **pend, int *pflags);
-E bool regex_match(atheme_regex_t *preg, char *string);
+E bool regex_match(atheme_regex_t *preg, const char *string);
 E bool regex_destroy(atheme_regex_t *preg);
 
 #endif
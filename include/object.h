@@ -16,12 +16,19 @@ struct metadata_ {
 
 typedef struct metadata_ metadata_t;
 
+typedef struct {
+	void *target;
+	const char *name;
+	const char *value;
+} hook_metadata_req_t;
+
 typedef void (*destructor_t)(void *);
 
 typedef struct {
 	int refcount;
 	destructor_t destructor;
-	mowgli_patricia_t *metadata;
+	metadata_t **metadata;	/* sorted by name, see metadata_find() */
+	unsigned int nmetadata;
 	mowgli_patricia_t *privatedata;
 #ifdef OBJECT_DEBUG
 	mowgli_node_t dnode;
@@ -50,6 +57,10 @@ E mowgli_list_t object_list;
 
 #define object(x) ((object_t *) x)
 
+/* iterates over the metadata of an object, in order of name */
+#define METADATA_FOREACH(md, i, target) \
+	for ((i) = 0; (i) < object(target)->nmetadata && ((md) = object(target)->metadata[(i)]) != NULL; (i)++)
+
 #endif
 
 /* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
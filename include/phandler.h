@@ -303,6 +303,10 @@ E struct cmode_ *user_mode_list;
 
 E ircd_t *ircd;
 
+/* send.c: batching lines to the uplink */
+E void sts_batch_begin(void);
+E void sts_batch_end(void);
+
 #endif
 
 /* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
@@ -17,6 +17,8 @@ struct pcommand_ {
 	void	(*handler)(sourceinfo_t *si, int parc, char *parv[]);
 	int	minparc;
 	int	sourcetype;
+	unsigned long	calls;		/* times the handler ran */
+	unsigned long long	usec;	/* time spent in the handler */
 };
 
 /* values for sourcetype */
@@ -39,6 +41,7 @@ E void pcommand_add(const char *token,
 	int minparc, int sourcetype);
 E void pcommand_delete(const char *token);
 E pcommand_t *pcommand_find(const char *token);
+E void pcommand_exec(pcommand_t *pcmd, sourceinfo_t *si, int parc, char *parv[]);
 
 /* ptasks.c */
 E int get_version_string(char *, size_t);
@@ -108,6 +108,7 @@ E void logfile_unregister(logfile_t *lf);
 E void log_open(void);
 E void log_shutdown(void);
 E bool log_debug_enabled(void);
+E bool log_level_enabled(unsigned int level);
 E void log_master_set_mask(unsigned int mask);
 E logfile_t *logfile_find_mask(unsigned int log_mask);
 E void slog(unsigned int level, const char *fmt, ...) PRINTFLIKE(2, 3);
@@ -168,6 +169,18 @@ E char *timediff(time_t seconds);
         } while (0)
 #endif
 
+#ifndef timeradd
+#define timeradd(tvp, uvp, vvp)                                         \
+        do {                                                            \
+                (vvp)->tv_sec = (tvp)->tv_sec + (uvp)->tv_sec;          \
+                (vvp)->tv_usec = (tvp)->tv_usec + (uvp)->tv_usec;       \
+                if ((vvp)->tv_usec >= 1000000) {                        \
+                        (vvp)->tv_sec++;                                \
+                        (vvp)->tv_usec -= 1000000;                      \
+                }                                                       \
+        } while (0)
+#endif
+
 /* tokenize.c */
 E int sjtoken(char *message, char delimiter, char **parv);
 E int tokenize(char *message, char **parv);
@@ -9,6 +9,15 @@
 #ifndef USERS_H
 #define USERS_H
 
+/* the masks a user is matched against, see user_masks() */
+typedef struct {
+	const char *vhost; /* nick!user@vhost */
+	const char *chost; /* nick!user@chost */
+	const char *host; /* nick!user@host */
+	const char *ip; /* nick!user@ip, or nick!user@ if unknown */
+	const char *gecos; /* nick!user@host gecos */
+} usermasks_t;
+
 struct user_
 {
 	object_t parent;
@@ -38,6 +47,10 @@ struct user_
 	mowgli_node_t snode; /* for server_t.userlist */
 
 	char *certfp; /* client certificate fingerprint */
+
+	unsigned int chanacs_gen; /* see chanacs_user_flags() */
+
+	usermasks_t *masks; /* built on demand by user_masks() */
 };
 
 #define FLOOD_MSGS_FACTOR 256
@@ -90,6 +103,8 @@ E void user_changeuid(user_t *u, const char *uid);
 E bool user_changenick(user_t *u, const char *nick, time_t ts);
 E void user_mode(user_t *user, const char *modes);
 E void user_sethost(user_t *source, user_t *target, const char *host);
+E void user_mask_changed(user_t *u);
+E const usermasks_t *user_masks(user_t *u);
 E const char *user_get_umodestr(user_t *u);
 E bool user_is_channel_banned(user_t *u, char ban_type);
 
@@ -32,6 +32,11 @@ mowgli_patricia_t *oldnameslist;
 mowgli_patricia_t *mclist;
 mowgli_patricia_t *certfplist;
 
+/* lists of accounts by canonical email */
+static mowgli_patricia_t *emaillist;
+
+static void myuser_email_unindex(myuser_t *mu);
+
 mowgli_heap_t *myuser_heap;   /* HEAP_USER */
 mowgli_heap_t *mynick_heap;   /* HEAP_USER */
 mowgli_heap_t *mycertfp_heap; /* HEAP_USER */
@@ -73,6 +78,9 @@ void init_accounts(void)
 	oldnameslist = mowgli_patricia_create(irccasecanon);
 	mclist = mowgli_patricia_create(irccasecanon);
 	certfplist = mowgli_patricia_create(strcasecanon);
+
+	/* keyed by canonical email, which is already canonical */
+	emaillist = mowgli_patricia_create(NULL);
 }
 
 /*
@@ -127,7 +135,7 @@ myuser_t *myuser_add_id(const char *id, const char *name, const char *pass, cons
 	entity(mu)->type = ENT_USER;
 	entity(mu)->name = strshare_get(name);
 	mu->email = strshare_get(email);
-	mu->email_canonical = canonicalize_email(email);
+	myuser_canonicalize_email(mu);
 	if (id)
 	{
 		if (myentity_find_uid(id) == NULL)
@@ -171,6 +179,8 @@ myuser_t *myuser_add_id(const char *id, const char *name, const char *pass, cons
 
 	cnt.myuser++;
 
+	hook_call_myuser_add(mu);
+
 	return mu;
 }
 
@@ -204,6 +214,9 @@ void myuser_delete(myuser_t *mu)
 	if (!(runflags & RF_STARTING))
 		slog(LG_DEBUG, "myuser_delete(): %s", entity(mu)->name);
 
+	/* there is no point in loading data which is about to be freed */
+	mu->cold_len = 0;
+
 	myuser_name_remember(entity(mu)->name, mu);
 
 	hook_call_myuser_delete(mu);
@@ -325,6 +338,7 @@ void myuser_delete(myuser_t *mu)
 	/* entity(mu)->name is the index for this dtree */
 	myentity_del(entity(mu));
 
+	myuser_email_unindex(mu);
 	strshare_unref(mu->email);
 	strshare_unref(mu->email_canonical);
 	strshare_unref(entity(mu)->name);
@@ -363,6 +377,9 @@ void myuser_rename(myuser_t *mu, const char *name)
 	return_if_fail(name != NULL);
 	return_if_fail(strlen(name) < NICKLEN);
 
+	/* the rows in the database still carry the old name */
+	myuser_load_cold(mu);
+
 	mowgli_strlcpy(nb, entity(mu)->name, NICKLEN);
 	newname = strshare_get(name);
 
@@ -415,10 +432,96 @@ void myuser_set_email(myuser_t *mu, const char *newemail)
 	return_if_fail(newemail != NULL);
 
 	strshare_unref(mu->email);
-	strshare_unref(mu->email_canonical);
-
 	mu->email = strshare_get(newemail);
-	mu->email_canonical = canonicalize_email(newemail);
+	myuser_canonicalize_email(mu);
+
+	hook_call_myuser_change(mu);
+}
+
+static void myuser_email_unindex(myuser_t *mu)
+{
+	mowgli_list_t *l;
+
+	if (mu->email_canonical == NULL)
+		return;
+
+	l = mowgli_patricia_retrieve(emaillist, mu->email_canonical);
+	return_if_fail(l != NULL);
+
+	mowgli_node_delete(&mu->email_node, l);
+	if (MOWGLI_LIST_LENGTH(l) == 0)
+	{
+		mowgli_patricia_delete(emaillist, mu->email_canonical);
+		mowgli_list_free(l);
+	}
+}
+
+/*
+ * myuser_canonicalize_email(myuser_t *mu)
+ *
+ * (Re)computes the canonical form of an account's email address, after it
+ * was changed or the email canonicalizers were.
+ *
+ * Inputs:
+ *      - account to canonicalize the email address of
+ *
+ * Outputs:
+ *      - nothing
+ *
+ * Side Effects:
+ *      - the account is filed under its canonical email address
+ */
+void myuser_canonicalize_email(myuser_t *mu)
+{
+	mowgli_list_t *l;
+
+	return_if_fail(mu != NULL);
+
+	if (mu->email_canonical != NULL)
+	{
+		myuser_email_unindex(mu);
+		strshare_unref(mu->email_canonical);
+	}
+
+	mu->email_canonical = canonicalize_email(mu->email);
+	if (mu->email_canonical == NULL)
+		return;
+
+	if ((l = mowgli_patricia_retrieve(emaillist, mu->email_canonical)) == NULL)
+	{
+		l = mowgli_list_create();
+		mowgli_patricia_add(emaillist, mu->email_canonical, l);
+	}
+
+	mowgli_node_add(mu, &mu->email_node, l);
+}
+
+/*
+ * myuser_find_email(const char *email)
+ *
+ * Finds the accounts using an email address, after canonicalization.
+ *
+ * Inputs:
+ *      - email address to look up
+ *
+ * Outputs:
+ *      - list of myuser_t, or NULL if there are none
+ *
+ * Side Effects:
+ *      - none
+ */
+mowgli_list_t *myuser_find_email(const char *email)
+{
+	mowgli_list_t *l;
+	stringref email_canonical;
+
+	return_val_if_fail(email != NULL, NULL);
+
+	email_canonical = canonicalize_email(email);
+	l = mowgli_patricia_retrieve(emaillist, email_canonical);
+	strshare_unref(email_canonical);
+
+	return l;
 }
 
 /*
@@ -531,6 +634,8 @@ myuser_access_verify(user_t *u, myuser_t *mu)
 	if (!use_myuser_access)
 		return false;
 
+	myuser_load_cold(mu);
+
 	if (metadata_find(mu, "private:freeze:freezer"))
 		return false;
 
@@ -572,6 +677,8 @@ myuser_access_add(myuser_t *mu, const char *mask)
 	return_val_if_fail(mu != NULL, false);
 	return_val_if_fail(mask != NULL, false);
 
+	myuser_load_cold(mu);
+
 	if (MOWGLI_LIST_LENGTH(&mu->access_list) > me.mdlimit)
 	{
 		slog(LG_DEBUG, "myuser_access_add(): access entry limit reached for %s", entity(mu)->name);
@@ -607,6 +714,8 @@ myuser_access_find(myuser_t *mu, const char *mask)
 	return_val_if_fail(mu != NULL, NULL);
 	return_val_if_fail(mask != NULL, NULL);
 
+	myuser_load_cold(mu);
+
 	MOWGLI_ITER_FOREACH(n, mu->access_list.head)
 	{
 		char *entry = (char *) n->data;
@@ -699,6 +808,8 @@ mynick_t *mynick_add(myuser_t *mu, const char *name)
 
 	cnt.mynick++;
 
+	hook_call_mynick_add(mn);
+
 	return mn;
 }
 
@@ -723,6 +834,8 @@ void mynick_delete(mynick_t *mn)
 	if (!(runflags & RF_STARTING))
 		slog(LG_DEBUG, "mynick_delete(): %s", mn->nick);
 
+	hook_call_mynick_delete(mn);
+
 	myuser_name_remember(mn->nick, mn->owner);
 
 	mowgli_patricia_delete(nicklist, mn->nick);
@@ -866,7 +979,7 @@ void myuser_name_restore(const char *name, myuser_t *mu)
 {
 	myuser_name_t *mun;
 	metadata_t *md, *md2;
-	mowgli_patricia_iteration_state_t state;
+	unsigned int mdi;
 	char *copy;
 
 	mun = myuser_name_find(name);
@@ -891,7 +1004,7 @@ void myuser_name_restore(const char *name, myuser_t *mu)
 
 	if (object(mun)->metadata)
 	{
-		MOWGLI_PATRICIA_FOREACH(md, &state, object(mun)->metadata)
+		METADATA_FOREACH(md, mdi, mun)
 		{
 			/* prefer current metadata to saved */
 			if (!metadata_find(mu, md->name))
@@ -971,6 +1084,8 @@ static void mychan_delete(mychan_t *mc)
 	if (!(runflags & RF_STARTING))
 		slog(LG_DEBUG, "mychan_delete(): %s", mc->name);
 
+	hook_call_mychan_delete(mc);
+
 	if (mc->chan != NULL)
 		mc->chan->mychan = NULL;
 
@@ -1005,6 +1120,7 @@ mychan_t *mychan_add(char *name)
 	mc->name = strshare_get(name);
 	mc->registered = CURRTIME;
 	mc->chan = channel_find(name);
+	chanacs_cache_invalidate_channel(mc);
 
 	if (mc->chan != NULL)
 		mc->chan->mychan = mc;
@@ -1013,6 +1129,8 @@ mychan_t *mychan_add(char *name)
 
 	cnt.mychan++;
 
+	hook_call_mychan_add(mc);
+
 	return mc;
 }
 
@@ -1352,7 +1470,11 @@ static void chanacs_delete(chanacs_t *ca)
 		slog(LG_DEBUG, "chanacs_delete(): %s -> %s [%s]", ca->mychan->name,
 			ca->entity != NULL ? entity(ca->entity)->name : ca->host,
 			ca->entity != NULL ? "entity" : "hostmask");
+
+	hook_call_chanacs_delete(ca);
+
 	mowgli_node_delete(&ca->cnode, &ca->mychan->chanacs);
+	chanacs_cache_invalidate_channel(ca->mychan);
 
 	if (ca->entity != NULL)
 	{
@@ -1368,7 +1490,10 @@ static void chanacs_delete(chanacs_t *ca)
 	metadata_delete_all(ca);
 
 	if (ca->host != NULL)
+	{
+		hostmatch_destroy(ca->matcher);
 		free(ca->host);
+	}
 
 	mowgli_heap_free(chanacs_heap, ca);
 
@@ -1419,9 +1544,12 @@ chanacs_t *chanacs_add(mychan_t *mychan, myentity_t *mt, unsigned int level, tim
 
 	mowgli_node_add(ca, &ca->cnode, &mychan->chanacs);
 	mowgli_node_add(ca, &ca->unode, &mt->chanacs);
+	chanacs_cache_invalidate_channel(mychan);
 
 	cnt.chanacs++;
 
+	hook_call_chanacs_change(ca);
+
 	return ca;
 }
 
@@ -1463,14 +1591,18 @@ chanacs_t *chanacs_add_host(mychan_t *mychan, const char *host, unsigned int lev
 	ca->mychan = mychan;
 	ca->entity = NULL;
 	ca->host = sstrdup(host);
+	ca->matcher = hostmatch_create(host);
 	ca->level = level & ca_all;
 	ca->tmodified = ts;
 	ca->setter = setter != NULL ? strshare_ref(setter->name) : NULL;
 
 	mowgli_node_add(ca, &ca->cnode, &mychan->chanacs);
+	chanacs_cache_invalidate_channel(mychan);
 
 	cnt.chanacs++;
 
+	hook_call_chanacs_change(ca);
+
 	return ca;
 }
 
@@ -1700,7 +1832,7 @@ bool chanacs_user_has_flag(mychan_t *mychan, user_t *u, unsigned int level)
 	return false;
 }
 
-static unsigned int chanacs_entity_flags_by_user(mychan_t *mychan, user_t *u)
+static unsigned int chanacs_entity_flags_by_user(mychan_t *mychan, user_t *u, bool *cacheable)
 {
 	mowgli_node_t *n;
 	unsigned int result = 0;
@@ -1718,6 +1850,11 @@ static unsigned int chanacs_entity_flags_by_user(mychan_t *mychan, user_t *u)
 			continue;
 
 		mt = ca->entity;
+
+		/* exttargets may depend on anything about the user */
+		if (isdynamic(mt))
+			*cacheable = false;
+
 		vt = myentity_get_chanacs_validator(mt);
 
 		if (vt->match_user && vt->match_user(ca, u) != NULL)
@@ -1729,18 +1866,68 @@ static unsigned int chanacs_entity_flags_by_user(mychan_t *mychan, user_t *u)
 	return result;
 }
 
+/* The access of channel members is cached in their chanuser_t.  A cached
+ * result is good while it is newer than the last change to the channel's
+ * access list, to the user's mask and to group memberships; these all
+ * take their generation from the same counter.  Logins and logouts are
+ * caught by remembering the account the result was computed for.
+ */
+static unsigned int chanacs_generation;
+static unsigned int chanacs_all_gen;
+
+void chanacs_cache_invalidate_user(user_t *u)
+{
+	u->chanacs_gen = ++chanacs_generation;
+}
+
+void chanacs_cache_invalidate_channel(mychan_t *mc)
+{
+	mc->chanacs_gen = ++chanacs_generation;
+}
+
+void chanacs_cache_invalidate_all(void)
+{
+	chanacs_all_gen = ++chanacs_generation;
+}
+
 unsigned int chanacs_user_flags(mychan_t *mychan, user_t *u)
 {
 	myentity_t *mt;
-	unsigned int result = 0;
+	chanuser_t *cu = NULL;
+	unsigned int result = 0, hostresult;
+	bool cacheable = true;
 
 	return_val_if_fail(mychan != NULL && u != NULL, 0);
 
-	mt = entity(u->myuser);
-	if (mt != NULL)
-		result |= chanacs_entity_flags(mychan, mt);
+	if (mychan->chan != NULL)
+		cu = chanuser_find(mychan->chan, u);
 
-	result |= chanacs_entity_flags_by_user(mychan, u);
+	if (cu != NULL && cu->acs_mu == u->myuser && cu->acs_gen > mychan->chanacs_gen &&
+			cu->acs_gen > u->chanacs_gen && cu->acs_gen > chanacs_all_gen)
+	{
+		cnt.chanacs_cache_hit++;
+		result = cu->acs_flags;
+		hostresult = cu->acs_hostflags;
+	}
+	else
+	{
+		mt = entity(u->myuser);
+		if (mt != NULL)
+			result |= chanacs_entity_flags(mychan, mt);
+
+		result |= chanacs_entity_flags_by_user(mychan, u, &cacheable);
+
+		hostresult = chanacs_host_flags_by_user(mychan, u);
+
+		if (cu != NULL)
+		{
+			cnt.chanacs_cache_miss++;
+			cu->acs_mu = u->myuser;
+			cu->acs_gen = cacheable ? ++chanacs_generation : 0;
+			cu->acs_flags = result;
+			cu->acs_hostflags = hostresult;
+		}
+	}
 
 	/* the user is pending e-mail verification.  so, we want to filter out all flags
 	 * other than CA_AKICK (+b).  that way they have no effective access.  --kaniini
@@ -1748,11 +1935,7 @@ unsigned int chanacs_user_flags(mychan_t *mychan, user_t *u)
 	if (u->myuser != NULL && (u->myuser->flags & MU_WAITAUTH))
 		result &= ~(ca_all & ~CA_AKICK);
 
-	result |= chanacs_host_flags_by_user(mychan, u);
-
-	slog(LG_DEBUG, "chanacs_user_flags(%s, %s): return %s", mychan->name, u->nick, bitmask_to_flags(result));
-
-	return result;
+	return result | hostresult;
 }
 
 unsigned int chanacs_source_flags(mychan_t *mychan, sourceinfo_t *si)
@@ -1829,6 +2012,9 @@ bool chanacs_modify(chanacs_t *ca, unsigned int *addflags, unsigned int *removef
 		return false;
 	ca->level = (ca->level | *addflags) & ~*removeflags;
 	ca->tmodified = CURRTIME;
+	chanacs_cache_invalidate_channel(ca->mychan);
+
+	hook_call_chanacs_change(ca);
 
 	return true;
 }
@@ -1894,6 +2080,11 @@ bool chanacs_change(mychan_t *mychan, myentity_t *mt, const char *hostmask, unsi
 			ca->tmodified = CURRTIME;
 			if (ca->level == 0)
 				object_unref(ca);
+			else
+			{
+				chanacs_cache_invalidate_channel(mychan);
+				hook_call_chanacs_change(ca);
+			}
 		}
 	}
 	else /* hostmask != NULL */
@@ -1930,6 +2121,11 @@ bool chanacs_change(mychan_t *mychan, myentity_t *mt, const char *hostmask, unsi
 			ca->tmodified = CURRTIME;
 			if (ca->level == 0)
 				object_unref(ca);
+			else
+			{
+				chanacs_cache_invalidate_channel(mychan);
+				hook_call_chanacs_change(ca);
+			}
 		}
 	}
 	return true;
@@ -1945,6 +2141,125 @@ bool chanacs_change_simple(mychan_t *mychan, myentity_t *mt, const char *hostmas
 	return chanacs_change(mychan, mt, hostmask, &a, &r, ca_all, setter);
 }
 
+/*
+ * metadata_db_type(void *target)
+ *
+ * Works out which kind of database row carries metadata for an object.
+ *
+ * Inputs:
+ *      - an object which may have metadata
+ *
+ * Outputs:
+ *      - "MDU", "MDC", "MDA" or "MDN" for accounts, channels, channel
+ *        access entries and old account names respectively, or NULL if
+ *        the object is of some other type
+ *
+ * Side Effects:
+ *      - none
+ */
+const char *metadata_db_type(void *target)
+{
+	destructor_t des;
+
+	return_val_if_fail(target != NULL, NULL);
+
+	des = object(target)->destructor;
+
+	if (des == (destructor_t) myuser_delete)
+		return "MDU";
+	else if (des == (destructor_t) mychan_delete)
+		return "MDC";
+	else if (des == (destructor_t) chanacs_delete)
+		return "MDA";
+	else if (des == (destructor_t) myuser_name_delete)
+		return "MDN";
+
+	return NULL;
+}
+
+/* set while myuser_load_cold() replays database rows */
+bool myuser_cold_loading = false;
+
+/* metadata which is looked at for accounts nobody is using, and so is
+ * never left in the database with the rest: expiry checks for vacation.
+ */
+static const char *const myuser_hot_metadata[] = {
+	"private:vacation",
+	NULL
+};
+
+/*
+ * myuser_metadata_is_hot(const char *name)
+ *
+ * Tells whether an account's metadata entry is always kept in memory,
+ * so that metadata_find() need not load the account's cold data for it.
+ *
+ * Inputs:
+ *      - a metadata key
+ *
+ * Outputs:
+ *      - true if the key is never part of the cold data
+ *
+ * Side Effects:
+ *      - none
+ */
+bool myuser_metadata_is_hot(const char *name)
+{
+	const char *const *p;
+
+	for (p = myuser_hot_metadata; *p != NULL; p++)
+		if (!strcmp(*p, name))
+			return true;
+
+	return false;
+}
+
+/*
+ * myuser_load_cold(myuser_t *mu)
+ *
+ * Loads the memos, memo ignores, access list and metadata of an account,
+ * if the database backend left them in the database at startup.  This
+ * is done implicitly by the metadata and access list functions and on
+ * login; code which uses mu->memos or mu->memo_ignores of an account
+ * which may not be logged in must call it first.
+ *
+ * Inputs:
+ *      - an account
+ *
+ * Outputs:
+ *      - nothing
+ *
+ * Side Effects:
+ *      - the account's data is read from the database
+ */
+void myuser_load_cold(myuser_t *mu)
+{
+	off_t offset;
+	size_t len;
+
+	return_if_fail(mu != NULL);
+
+	if (mu->cold_len == 0)
+		return;
+
+	/* the rows being loaded add metadata etc. through the functions
+	 * which call us.
+	 */
+	offset = mu->cold_offset;
+	len = mu->cold_len;
+	mu->cold_len = 0;
+
+	if (db_mod == NULL || db_mod->db_load_cold == NULL)
+	{
+		slog(LG_ERROR, "myuser_load_cold(): no database backend can load the data of %s", entity(mu)->name);
+		return;
+	}
+
+	myuser_cold_loading = true;
+	db_mod->db_load_cold(mu, offset, len);
+	myuser_cold_loading = false;
+}
+
 static int expire_myuser_cb(myentity_t *mt, void *unused)
 {
 	hook_expiry_req_t req;
@@ -42,6 +42,8 @@ void set_password(myuser_t *mu, const char *newpassword)
 		mu->flags &= ~MU_CRYPTPASS;			/* just in case */
 		mowgli_strlcpy(mu->pass, newpassword, PASSLEN);
 	}
+
+	hook_call_myuser_change(mu);
 }
 
 bool verify_password(myuser_t *mu, const char *password)
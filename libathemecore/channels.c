@@ -58,6 +58,70 @@ void init_channels(void)
 	chanlist = mowgli_patricia_create(irccasecanon);
 }
 
+/* Large channels have an open-addressed hash table of their members by
+ * user, kept at most half full, so that chanuser_find() does not have to
+ * walk a long member list.
+ */
+static inline unsigned int chanuser_hashval(user_t *u, unsigned int size)
+{
+	return ((unsigned int)((unsigned long)u >> 4) * 2654435761U) & (size - 1);
+}
+
+static void chanuser_hash_insert(channel_t *c, chanuser_t *cu)
+{
+	unsigned int i = chanuser_hashval(cu->user, c->memberhashsize);
+
+	while (c->memberhash[i] != NULL)
+		i = (i + 1) & (c->memberhashsize - 1);
+
+	c->memberhash[i] = cu;
+}
+
+static void chanuser_hash_build(channel_t *c, unsigned int size)
+{
+	mowgli_node_t *n;
+
+	free(c->memberhash);
+	c->memberhash = scalloc(size, sizeof(chanuser_t *));
+	c->memberhashsize = size;
+
+	MOWGLI_ITER_FOREACH(n, c->members.head)
+		chanuser_hash_insert(c, n->data);
+}
+
+static void chanuser_hash_destroy(channel_t *c)
+{
+	free(c->memberhash);
+	c->memberhash = NULL;
+	c->memberhashsize = 0;
+}
+
+static void chanuser_hash_remove(channel_t *c, chanuser_t *cu)
+{
+	unsigned int mask = c->memberhashsize - 1;
+	unsigned int i, j, k;
+
+	i = chanuser_hashval(cu->user, c->memberhashsize);
+	while (c->memberhash[i] != cu)
+	{
+		return_if_fail(c->memberhash[i] != NULL);
+		i = (i + 1) & mask;
+	}
+
+	/* move back entries which would no longer be found past the hole */
+	for (j = (i + 1) & mask; c->memberhash[j] != NULL; j = (j + 1) & mask)
+	{
+		k = chanuser_hashval(c->memberhash[j]->user, c->memberhashsize);
+		if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j)))
+		{
+			c->memberhash[i] = c->memberhash[j];
+			i = j;
+		}
+	}
+
+	c->memberhash[i] = NULL;
+}
+
 /*
  * channel_add(const char *name, time_t ts, server_t *creator)
  *
@@ -115,6 +179,8 @@ channel_t *channel_add(const char *name, time_t ts, server_t *creator)
 	c->bans.head = NULL;
 	c->bans.tail = NULL;
 	c->bans.count = 0;
+	c->banlists = NULL;
+	c->numbanlists = 0;
 
 	if ((mc = mychan_find(c->name)))
 		mc->chan = c;
@@ -183,8 +249,11 @@ void channel_delete(channel_t *c)
 	if ((mc = mychan_find(c->name)))
 		mc->chan = NULL;
 
+	chanuser_hash_destroy(c);
+
 	clear_simple_modes(c);
 	chanban_clear(c);
+	free(c->banlists);
 
 	if (c->extmodes != NULL)
 		free(c->extmodes);
@@ -200,6 +269,52 @@ void channel_delete(channel_t *c)
 	cnt.chan--;
 }
 
+/* Bans are also kept in one list per type, so that matching a user
+ * against the +b list does not walk the exceptions and invex entries as
+ * well; once a list gets long its masks are indexed for chanban_find().
+ */
+#define CHANBAN_HASH_THRESHOLD 16
+
+static chanbanlist_t *chanbanlist_find(channel_t *chan, int type)
+{
+	unsigned int i;
+
+	for (i = 0; i < chan->numbanlists; i++)
+		if (chan->banlists[i].type == type)
+			return &chan->banlists[i];
+
+	return NULL;
+}
+
+static chanbanlist_t *chanbanlist_get(channel_t *chan, int type)
+{
+	chanbanlist_t *bl;
+
+	if ((bl = chanbanlist_find(chan, type)) != NULL)
+		return bl;
+
+	chan->banlists = srealloc(chan->banlists, (chan->numbanlists + 1) * sizeof(chanbanlist_t));
+	bl = &chan->banlists[chan->numbanlists++];
+	memset(bl, 0, sizeof *bl);
+	bl->type = type;
+
+	return bl;
+}
+
+static void chanbanlist_index(chanbanlist_t *bl)
+{
+	mowgli_node_t *n;
+	chanban_t *cb;
+
+	bl->masks = mowgli_patricia_create(irccasecanon);
+
+	MOWGLI_ITER_FOREACH(n, bl->bans.head)
+	{
+		cb = n->data;
+		mowgli_patricia_add(bl->masks, cb->mask, cb);
+	}
+}
+
 /*
  * chanban_add(channel_t *chan, const char *mask, int type)
  *
@@ -220,6 +335,7 @@ void channel_delete(channel_t *c)
 chanban_t *chanban_add(channel_t *chan, const char *mask, int type)
 {
 	chanban_t *c;
+	chanbanlist_t *bl;
 
 	return_val_if_fail(chan != NULL, NULL);
 	return_val_if_fail(mask != NULL, NULL);
@@ -245,10 +361,19 @@ chanban_t *chanban_add(channel_t *chan, const char *mask, int type)
 
 	c->chan = chan;
 	c->mask = sstrdup(mask);
+	c->matcher = hostmatch_create(mask);
 	c->type = type;
 
 	mowgli_node_add(c, &c->node, &chan->bans);
 
+	bl = chanbanlist_get(chan, type);
+	mowgli_node_add(c, &c->tnode, &bl->bans);
+
+	if (bl->masks != NULL)
+		mowgli_patricia_add(bl->masks, c->mask, c);
+	else if (MOWGLI_LIST_LENGTH(&bl->bans) >= CHANBAN_HASH_THRESHOLD)
+		chanbanlist_index(bl);
+
 	return c;
 }
 
@@ -268,10 +393,27 @@ chanban_t *chanban_add(channel_t *chan, const char *mask, int type)
  */
 void chanban_delete(chanban_t * c)
 {
+	chanbanlist_t *bl;
+
 	return_if_fail(c != NULL);
 
 	mowgli_node_delete(&c->node, &c->chan->bans);
 
+	bl = chanbanlist_find(c->chan, c->type);
+	mowgli_node_delete(&c->tnode, &bl->bans);
+
+	if (bl->masks != NULL)
+	{
+		if (MOWGLI_LIST_LENGTH(&bl->bans) == 0)
+		{
+			mowgli_patricia_destroy(bl->masks, NULL, NULL);
+			bl->masks = NULL;
+		}
+		else
+			mowgli_patricia_delete(bl->masks, c->mask);
+	}
+
+	hostmatch_destroy(c->matcher);
 	free(c->mask);
 	mowgli_heap_free(chanban_heap, c);
 }
@@ -296,22 +438,58 @@ void chanban_delete(chanban_t * c)
 chanban_t *chanban_find(channel_t *chan, const char *mask, int type)
 {
 	chanban_t *c;
+	chanbanlist_t *bl;
 	mowgli_node_t *n;
 
 	return_val_if_fail(chan != NULL, NULL);
 	return_val_if_fail(mask != NULL, NULL);
 
-	MOWGLI_ITER_FOREACH(n, chan->bans.head)
+	if ((bl = chanbanlist_find(chan, type)) == NULL)
+		return NULL;
+
+	if (bl->masks != NULL)
+		return mowgli_patricia_retrieve(bl->masks, mask);
+
+	MOWGLI_ITER_FOREACH(n, bl->bans.head)
 	{
 		c = n->data;
 
-		if (c->type == type && !irccasecmp(c->mask, mask))
+		if (!irccasecmp(c->mask, mask))
 			return c;
 	}
 
 	return NULL;
 }
 
+/*
+ * chanban_first(channel_t *chan, int type)
+ *
+ * Finds the first ban of a given type on a channel.
+ *
+ * Inputs:
+ *     - channel to look at
+ *     - type of ban, e.g. 'b' or 'e'
+ *
+ * Outputs:
+ *     - the node of the first such ban, or NULL if there are none;
+ *       following ->next from it visits only bans of the same type,
+ *       so it may be passed to next_matching_ban()
+ *
+ * Side Effects:
+ *     - none
+ */
+mowgli_node_t *chanban_first(channel_t *chan, int type)
+{
+	chanbanlist_t *bl;
+
+	return_val_if_fail(chan != NULL, NULL);
+
+	if ((bl = chanbanlist_find(chan, type)) == NULL)
+		return NULL;
+
+	return bl->bans.head;
+}
+
 /*
  * chanuser_add(channel_t *chan, const char *nick)
  *
@@ -407,6 +585,22 @@ chanuser_t *chanuser_add(channel_t *chan, const char *nick)
 	mowgli_node_add(cu, &cu->cnode, &chan->members);
 	mowgli_node_add(cu, &cu->unode, &u->channels);
 
+	if (chan->memberhash != NULL)
+	{
+		if (chan->nummembers * 2 > chan->memberhashsize)
+			chanuser_hash_build(chan, chan->memberhashsize * 2);
+		else
+			chanuser_hash_insert(chan, cu);
+	}
+	else if (config_options.member_hash_threshold != 0 && chan->nummembers >= config_options.member_hash_threshold)
+	{
+		unsigned int size = 16;
+
+		while (size < chan->nummembers * 4)
+			size *= 2;
+		chanuser_hash_build(chan, size);
+	}
+
 	cnt.chanuser++;
 
 	hdata.cu = cu;
@@ -457,6 +651,14 @@ void chanuser_delete(channel_t *chan, user_t *user)
 	mowgli_node_delete(&cu->cnode, &chan->members);
 	mowgli_node_delete(&cu->unode, &user->channels);
 
+	if (chan->memberhash != NULL)
+	{
+		if (chan->nummembers - 1 < config_options.member_hash_threshold / 2)
+			chanuser_hash_destroy(chan);
+		else
+			chanuser_hash_remove(chan, cu);
+	}
+
 	mowgli_heap_free(chanuser_heap, cu);
 
 	chan->nummembers--;
@@ -498,6 +700,20 @@ chanuser_t *chanuser_find(channel_t *chan, user_t *user)
 	return_val_if_fail(chan != NULL, NULL);
 	return_val_if_fail(user != NULL, NULL);
 
+	if (chan->memberhash != NULL)
+	{
+		unsigned int i = chanuser_hashval(user, chan->memberhashsize);
+
+		while ((cu = chan->memberhash[i]) != NULL)
+		{
+			if (cu->user == user)
+				return cu;
+			i = (i + 1) & (chan->memberhashsize - 1);
+		}
+
+		return NULL;
+	}
+
 	/* choose shortest list to search -- jilles */
 	if (MOWGLI_LIST_LENGTH(&user->channels) < MOWGLI_LIST_LENGTH(&chan->members))
 	{
@@ -366,6 +366,96 @@ match_cidr(const char *s1, const char *s2)
 		return 1;
 }
 
+/* cidr_parse()
+ *
+ * Input - ip mask i/c, buffer of IN6ADDRSZ bytes for the network
+ * Output - prefix length, or 0 if this is not a CIDR mask;
+ *          *v6 says whether it is an IPv6 one
+ * parses once what match_ips() parses on every call, see cidr_match()
+ */
+int cidr_parse(const char *s, unsigned char *addr, bool *v6)
+{
+	char ipmask[BUFSIZE];
+	char *len;
+	int cidrlen;
+
+	return_val_if_fail(s != NULL, 0);
+
+	mowgli_strlcpy(ipmask, s, sizeof ipmask);
+
+	len = strrchr(ipmask, '/');
+	if (len == NULL)
+		return 0;
+
+	*len++ = '\0';
+
+	cidrlen = atoi(len);
+	if (cidrlen <= 0)
+		return 0;
+
+	*v6 = strchr(ipmask, ':') != NULL;
+
+	if (*v6)
+	{
+		if (cidrlen > 128 || !inet_pton6(ipmask, addr))
+			return 0;
+	}
+	else
+	{
+		if (cidrlen > 32 || !inet_pton4(ipmask, addr))
+			return 0;
+	}
+
+	return cidrlen;
+}
+
+/* cidr_match()
+ *
+ * Input - network, prefix length and family from cidr_parse(), address
+ * Output - 0 = Matched 1 = Did not match
+ */
+int cidr_match(const unsigned char *addr, int cidrlen, bool v6, const char *s)
+{
+	unsigned char ipaddr[IN6ADDRSZ];
+	char ip[HOSTLEN + 1];
+
+	if (s == NULL || cidrlen == 0)
+		return 1;
+
+	if (v6 != (strchr(s, ':') != NULL))
+		return 1;
+
+	mowgli_strlcpy(ip, s, sizeof ip);
+
+	if (v6 ? !inet_pton6(ip, ipaddr) : !inet_pton4(ip, ipaddr))
+		return 1;
+
+	return !comp_with_mask(ipaddr, (void *)addr, cidrlen);
+}
+
+/* cidr_parse_ip()
+ *
+ * Input - ip address, buffer of IN6ADDRSZ bytes for it
+ * Output - address length in bits, or 0 if this is not an ip address;
+ *          *v6 says whether it is an IPv6 one
+ */
+int cidr_parse_ip(const char *s, unsigned char *addr, bool *v6)
+{
+	char ip[HOSTLEN + 1];
+
+	if (s == NULL)
+		return 0;
+
+	*v6 = strchr(s, ':') != NULL;
+
+	mowgli_strlcpy(ip, s, sizeof ip);
+
+	if (*v6)
+		return inet_pton6(ip, addr) ? 128 : 0;
+
+	return inet_pton4(ip, addr) ? 32 : 0;
+}
+
 int valid_ip_or_mask(const char *src)
 {
 	char ipaddr[HOSTLEN + 6];
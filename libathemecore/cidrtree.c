@@ -0,0 +1,425 @@
+/*
+ * atheme-services: A collection of minimalist IRC services
+ * cidrtree.c: Radix trees of IP address prefixes.
+ *
+ * Copyright (c) 2026 Atheme Development Group
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atheme.h"
+
+/*
+ * A cidrtree_t maps IP prefixes ("192.0.2.0/24", "2001:db8::/32" or plain
+ * addresses, which are full-length prefixes) to data, with one path
+ * compressed binary trie per address family.  Each node holds a prefix;
+ * its children hold longer prefixes that continue it with a 0 or 1 bit.
+ * Nodes without data only join two subtrees.  Looking up an address
+ * follows one path from the root, so it costs at most one step per
+ * address bit, however many prefixes the tree has.
+ *
+ * Prefixes are stored with the bits past their length cleared, so that
+ * "192.0.2.1/24" and "192.0.2.0/24" are the same prefix, as they are to
+ * match_ips().
+ */
+
+typedef struct cidrnode_ cidrnode_t;
+
+struct cidrnode_
+{
+	unsigned char addr[16];
+	unsigned int len;
+	cidrnode_t *child[2];
+	void *data;
+};
+
+struct cidrtree_
+{
+	cidrnode_t *root4;
+	cidrnode_t *root6;
+};
+
+static mowgli_heap_t *cidrnode_heap;
+
+static inline unsigned int cidr_bit(const unsigned char *addr, unsigned int bit)
+{
+	return (addr[bit >> 3] >> (7 - (bit & 7))) & 1;
+}
+
+/* number of leading bits a and b have in common, at most limit */
+static unsigned int cidr_common(const unsigned char *a, const unsigned char *b, unsigned int limit)
+{
+	unsigned int i;
+	unsigned char x;
+
+	for (i = 0; i < limit; i += 8)
+	{
+		x = a[i >> 3] ^ b[i >> 3];
+		if (x == 0)
+			continue;
+		while (!(x & 0x80))
+		{
+			x <<= 1;
+			i++;
+		}
+		return i < limit ? i : limit;
+	}
+
+	return limit;
+}
+
+static void cidr_clear(unsigned char *addr, unsigned int len)
+{
+	unsigned int i;
+
+	for (i = len; i < 128; i++)
+		addr[i >> 3] &= ~(0x80 >> (i & 7));
+}
+
+static cidrnode_t *cidrnode_create(const unsigned char *addr, unsigned int len, void *data)
+{
+	cidrnode_t *node = mowgli_heap_alloc(cidrnode_heap);
+
+	memcpy(node->addr, addr, sizeof node->addr);
+	node->len = len;
+	node->data = data;
+	return node;
+}
+
+static void cidrnode_destroy(cidrnode_t *node)
+{
+	if (node == NULL)
+		return;
+
+	cidrnode_destroy(node->child[0]);
+	cidrnode_destroy(node->child[1]);
+	mowgli_heap_free(cidrnode_heap, node);
+}
+
+/* parses a prefix or address, returning the root it belongs under */
+static cidrnode_t **cidrtree_parse(cidrtree_t *tree, const char *mask, unsigned char *addr, unsigned int *len)
+{
+	bool v6 = false;
+	int bits;
+
+	memset(addr, 0, 16);
+
+	if (strchr(mask, '/') != NULL)
+		bits = cidr_parse(mask, addr, &v6);
+	else
+		bits = cidr_parse_ip(mask, addr, &v6);
+
+	if (bits <= 0)
+		return NULL;
+
+	*len = bits;
+	cidr_clear(addr, *len);
+
+	return v6 ? &tree->root6 : &tree->root4;
+}
+
+cidrtree_t *cidrtree_create(void)
+{
+	if (cidrnode_heap == NULL)
+		cidrnode_heap = sharedheap_get(sizeof(cidrnode_t));
+
+	return scalloc(1, sizeof(cidrtree_t));
+}
+
+void cidrtree_destroy(cidrtree_t *tree)
+{
+	return_if_fail(tree != NULL);
+
+	cidrnode_destroy(tree->root4);
+	cidrnode_destroy(tree->root6);
+	free(tree);
+}
+
+/*
+ * cidrtree_add(cidrtree_t *tree, const char *mask, void *data)
+ *
+ * Adds a prefix to a tree, replacing its data if it is already there.
+ *
+ * Inputs:
+ *     - tree to add to
+ *     - prefix as ip/len, or an ip address
+ *     - data for the prefix, not NULL
+ *
+ * Outputs:
+ *     - true if the prefix was added, false if it is not valid
+ *
+ * Side Effects:
+ *     - none
+ */
+bool cidrtree_add(cidrtree_t *tree, const char *mask, void *data)
+{
+	unsigned char addr[16];
+	unsigned int len, common;
+	cidrnode_t **slot, *node, *glue;
+
+	return_val_if_fail(tree != NULL, false);
+	return_val_if_fail(mask != NULL, false);
+	return_val_if_fail(data != NULL, false);
+
+	slot = cidrtree_parse(tree, mask, addr, &len);
+	if (slot == NULL)
+		return false;
+
+	while ((node = *slot) != NULL)
+	{
+		common = cidr_common(addr, node->addr, len < node->len ? len : node->len);
+
+		if (common == node->len && common == len)
+		{
+			node->data = data;
+			return true;
+		}
+
+		if (common == node->len)
+		{
+			slot = &node->child[cidr_bit(addr, node->len)];
+			continue;
+		}
+
+		/* the new prefix branches off above this node */
+		if (common == len)
+		{
+			*slot = cidrnode_create(addr, len, data);
+			(*slot)->child[cidr_bit(node->addr, len)] = node;
+			return true;
+		}
+
+		glue = cidrnode_create(addr, common, NULL);
+		cidr_clear(glue->addr, common);
+		glue->child[cidr_bit(addr, common)] = cidrnode_create(addr, len, data);
+		glue->child[cidr_bit(node->addr, common)] = node;
+		*slot = glue;
+		return true;
+	}
+
+	*slot = cidrnode_create(addr, len, data);
+	return true;
+}
+
+/* finds the slot pointing at a prefix, and the one pointing at its parent */
+static cidrnode_t **cidrtree_lookup(cidrtree_t *tree, const char *mask, cidrnode_t ***parentslot)
+{
+	unsigned char addr[16];
+	unsigned int len;
+	cidrnode_t **slot, *node;
+
+	slot = cidrtree_parse(tree, mask, addr, &len);
+	if (slot == NULL)
+		return NULL;
+
+	*parentslot = NULL;
+
+	while ((node = *slot) != NULL && node->len <= len)
+	{
+		if (cidr_common(addr, node->addr, node->len) != node->len)
+			return NULL;
+
+		if (node->len == len)
+			return node->data != NULL ? slot : NULL;
+
+		*parentslot = slot;
+		slot = &node->child[cidr_bit(addr, node->len)];
+	}
+
+	return NULL;
+}
+
+/*
+ * cidrtree_find(cidrtree_t *tree, const char *mask)
+ *
+ * Finds the data of exactly this prefix.
+ *
+ * Inputs:
+ *     - tree to look in
+ *     - prefix as ip/len, or an ip address
+ *
+ * Outputs:
+ *     - the data of the prefix, or NULL if it is not in the tree
+ *
+ * Side Effects:
+ *     - none
+ */
+void *cidrtree_find(cidrtree_t *tree, const char *mask)
+{
+	cidrnode_t **slot, **parentslot;
+
+	return_val_if_fail(tree != NULL, NULL);
+	return_val_if_fail(mask != NULL, NULL);
+
+	slot = cidrtree_lookup(tree, mask, &parentslot);
+
+	return slot != NULL ? (*slot)->data : NULL;
+}
+
+/*
+ * cidrtree_delete(cidrtree_t *tree, const char *mask)
+ *
+ * Removes a prefix from a tree.
+ *
+ * Inputs:
+ *     - tree to remove from
+ *     - prefix as ip/len, or an ip address
+ *
+ * Outputs:
+ *     - the data the prefix had, or NULL if it was not in the tree
+ *
+ * Side Effects:
+ *     - none
+ */
+void *cidrtree_delete(cidrtree_t *tree, const char *mask)
+{
+	cidrnode_t **slot, **parentslot, *node, *parent;
+	void *data;
+
+	return_val_if_fail(tree != NULL, NULL);
+	return_val_if_fail(mask != NULL, NULL);
+
+	slot = cidrtree_lookup(tree, mask, &parentslot);
+	if (slot == NULL)
+		return NULL;
+
+	node = *slot;
+	data = node->data;
+	node->data = NULL;
+
+	/* a node joining two subtrees stays; otherwise splice it out */
+	if (node->child[0] != NULL && node->child[1] != NULL)
+		return data;
+
+	*slot = node->child[0] != NULL ? node->child[0] : node->child[1];
+	mowgli_heap_free(cidrnode_heap, node);
+
+	/* and the parent, if it was only there to join this node in */
+	if (*slot == NULL && parentslot != NULL)
+	{
+		parent = *parentslot;
+		if (parent->data == NULL)
+		{
+			*parentslot = parent->child[0] != NULL ? parent->child[0] : parent->child[1];
+			mowgli_heap_free(cidrnode_heap, parent);
+		}
+	}
+
+	return data;
+}
+
+/*
+ * cidrtree_search_all(cidrtree_t *tree, const char *address,
+ *                     void *(*cb)(void *data, void *privdata), void *privdata)
+ *
+ * Calls a function for each prefix containing an address, shortest
+ * prefix first, until it returns something other than NULL.
+ *
+ * Inputs:
+ *     - tree to look in
+ *     - ip address
+ *     - function to call with the data of each prefix
+ *     - opaque data to pass to it
+ *
+ * Outputs:
+ *     - what the function returned, or NULL
+ *
+ * Side Effects:
+ *     - none
+ */
+void *cidrtree_search_all(cidrtree_t *tree, const char *address, void *(*cb)(void *data, void *privdata), void *privdata)
+{
+	unsigned char addr[16];
+	unsigned int len;
+	cidrnode_t **root, *node;
+	void *ret;
+
+	return_val_if_fail(tree != NULL, NULL);
+
+	if (address == NULL || strchr(address, '/') != NULL)
+		return NULL;
+
+	root = cidrtree_parse(tree, address, addr, &len);
+	if (root == NULL)
+		return NULL;
+
+	for (node = *root; node != NULL; node = node->child[cidr_bit(addr, node->len)])
+	{
+		if (cidr_common(addr, node->addr, node->len) != node->len)
+			break;
+
+		if (node->data != NULL && (ret = cb(node->data, privdata)) != NULL)
+			return ret;
+
+		if (node->len == len)
+			break;
+	}
+
+	return NULL;
+}
+
+/*
+ * cidrtree_search(cidrtree_t *tree, const char *address)
+ *
+ * Finds the longest prefix containing an address.
+ *
+ * Inputs:
+ *     - tree to look in
+ *     - ip address
+ *
+ * Outputs:
+ *     - the data of the longest prefix containing the address, or NULL
+ *
+ * Side Effects:
+ *     - none
+ */
+void *cidrtree_search(cidrtree_t *tree, const char *address)
+{
+	unsigned char addr[16];
+	unsigned int len;
+	cidrnode_t **root, *node;
+	void *data = NULL;
+
+	return_val_if_fail(tree != NULL, NULL);
+
+	if (address == NULL || strchr(address, '/') != NULL)
+		return NULL;
+
+	root = cidrtree_parse(tree, address, addr, &len);
+	if (root == NULL)
+		return NULL;
+
+	for (node = *root; node != NULL; node = node->child[cidr_bit(addr, node->len)])
+	{
+		if (cidr_common(addr, node->addr, node->len) != node->len)
+			break;
+
+		if (node->data != NULL)
+			data = node->data;
+
+		if (node->len == len)
+			break;
+	}
+
+	return data;
+}
+
+/* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
+ * vim:ts=8
+ * vim:sw=8
+ * vim:noexpandtab
+ */
@@ -677,6 +677,17 @@ static void modestack_flush_callback(void *arg)
 {
 	modestack_flush((struct modestackdata *)arg);
 	((struct modestackdata *)arg)->event = 0;
+	sts_batch_end();
+}
+
+/* arm the flush timer; the uplink stays corked until it fires, so that
+ * every MODE flushed in between is written out together */
+static void modestack_schedule(struct modestackdata *md)
+{
+	if (md->event)
+		return;
+	sts_batch_begin();
+	md->event = mowgli_timer_add_once(base_eventloop, "flush_cmode_callback", modestack_flush_callback, md, 0);
 }
 
 /* flush pending modes for a certain channel */
@@ -725,8 +736,7 @@ void modestack_mode_simple_real(const char *source, channel_t *channel, int dir,
 		return;
 	md = modestack_init(source, channel);
 	modestack_add_simple(md, dir, flags);
-	if (!md->event)
-		md->event = mowgli_timer_add_once(base_eventloop, "flush_cmode_callback", modestack_flush_callback, md, 0);
+	modestack_schedule(md);
 }
 void (*modestack_mode_simple)(const char *source, channel_t *channel, int dir, int flags) = modestack_mode_simple_real;
 
@@ -737,8 +747,7 @@ void modestack_mode_limit_real(const char *source, channel_t *channel, int dir,
 
 	md = modestack_init(source, channel);
 	modestack_add_limit(md, dir, limit);
-	if (!md->event)
-		md->event = mowgli_timer_add_once(base_eventloop, "flush_cmode_callback", modestack_flush_callback, md, 0);
+	modestack_schedule(md);
 }
 void (*modestack_mode_limit)(const char *source, channel_t *channel, int dir, unsigned int limit) = modestack_mode_limit_real;
 
@@ -755,8 +764,7 @@ void modestack_mode_ext_real(const char *source, channel_t *channel, int dir, un
 		return;
 	}
 	modestack_add_ext(md, dir, i, value);
-	if (!md->event)
-		md->event = mowgli_timer_add_once(base_eventloop, "flush_cmode_callback", modestack_flush_callback, md, 0);
+	modestack_schedule(md);
 }
 void (*modestack_mode_ext)(const char *source, channel_t *channel, int dir, unsigned int i, const char *value) = modestack_mode_ext_real;
 
@@ -767,8 +775,7 @@ void modestack_mode_param_real(const char *source, channel_t *channel, int dir,
 
 	md = modestack_init(source, channel);
 	modestack_add_param(md, dir, type, value);
-	if (!md->event)
-		md->event = mowgli_timer_add_once(base_eventloop, "flush_cmode_callback", modestack_flush_callback, md, 0);
+	modestack_schedule(md);
 }
 void (*modestack_mode_param)(const char *source, channel_t *channel, int dir, char type, const char *value) = modestack_mode_param_real;
 
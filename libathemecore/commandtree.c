@@ -88,7 +88,10 @@ void command_exec(service_t *svs, sourceinfo_t *si, command_t *c, int parc, char
 	const char *cmdaccess;
 
 	if (si->smu != NULL)
+	{
+		myuser_load_cold(si->smu);
 		language_set_active(si->smu->language);
+	}
 
 	/* Make this look a bit more expected for normal users */
 	if (si->smu == NULL && c->access != NULL && !strcasecmp(c->access, AC_AUTHENTICATED))
@@ -114,6 +114,7 @@ static struct Token logflags[] = {
 mowgli_list_t conf_si_table;
 mowgli_list_t conf_gi_table;
 mowgli_list_t conf_la_table;
+mowgli_list_t conf_db_table;
 
 /* *INDENT-ON* */
 
@@ -197,6 +198,7 @@ void init_newconf(void)
 	add_top_conf("LANGUAGE", c_language);
 	add_top_conf("STRING", c_string);
 	add_top_conf("LOGFILE", c_logfile);
+	add_subblock_top_conf("DATABASE", &conf_db_table);
 
 	/* serverinfo{} block */
 	add_dupstr_conf_item("NAME", &conf_si_table, CONF_NO_REHASH, &me.name, NULL);
@@ -253,6 +255,7 @@ void init_newconf(void)
 	add_conf_item("EXEMPTS", &conf_gi_table, c_gi_exempts);
 	add_conf_item("IMMUNE_LEVEL", &conf_gi_table, c_gi_immune_level);
 	add_bool_conf_item("SHOW_ENTITY_ID", &conf_gi_table, 0, &config_options.show_entity_id, false);
+	add_uint_conf_item("MEMBER_HASH_THRESHOLD", &conf_gi_table, 0, &config_options.member_hash_threshold, 0, INT_MAX, 128);
 
 	/* language:: stuff */
 	add_dupstr_conf_item("NAME", &conf_la_table, 0, &me.language_name, NULL);
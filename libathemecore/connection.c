@@ -668,8 +668,8 @@ void connection_setselect_write(connection_t *cptr,
 void connection_stats(void (*stats_cb)(const char *, void *), void *privdata)
 {
 	mowgli_node_t *n;
-	char buf[160];
-	char buf2[20];
+	char buf[300];
+	char buf2[100];
 
 	MOWGLI_ITER_FOREACH(n, connection_list.head)
 	{
@@ -695,6 +695,13 @@ void connection_stats(void (*stats_cb)(const char *, void *), void *privdata)
 			else if (c->flags & CF_SEND_EOF)
 				mowgli_strlcat(buf, " send_eof", sizeof buf);
 		}
+		if (c->sendq_queued != 0)
+		{
+			snprintf(buf2, sizeof buf2, " sendq %zu peak %zu queued %lu writes %lu",
+					c->sendq_len, c->sendq_peak,
+					c->sendq_queued, c->sendq_syscalls);
+			mowgli_strlcat(buf, buf2, sizeof buf);
+		}
 		stats_cb(buf, privdata);
 	}
 }
@@ -8,8 +8,34 @@
 #include "atheme.h"
 
 database_module_t *db_mod = NULL;
+bool db_full_load = false;
+
+/* rows loaded and written since startup, for benchmarks */
+unsigned int db_rows_read = 0;
+unsigned int db_rows_written = 0;
 mowgli_patricia_t *db_types = NULL;
 
+/* Row types by id, and an open-addressed hash of ids by case-folded name,
+ * so that resolving a row type is one hash probe in the common case instead
+ * of a patricia walk.  Ids are never reused; an unregistered type keeps its
+ * id with a NULL handler.
+ */
+static database_type_t **db_type_table = NULL;
+static unsigned int db_type_count = 1;
+static unsigned int db_type_tablesize = 0;
+
+static unsigned int *db_type_hash = NULL;
+static unsigned int db_type_hashsize = 0;
+
+/* rows are heavily clustered by type, so remember the last one */
+static database_type_t *db_type_last = NULL;
+
+/* load statistics: the type of the row being timed, and when it started */
+static database_type_t *db_type_timed = NULL;
+#ifdef HAVE_GETTIMEOFDAY
+static struct timeval db_type_mark;
+#endif
+
 database_handle_t *
 db_open(const char *filename, database_transaction_t txn)
 {
@@ -19,11 +45,11 @@ db_open(const char *filename, database_transaction_t txn)
 	return db_mod->db_open(filename, txn);
 }
 
-void
+bool
 db_close(database_handle_t *db)
 {
-	return_if_fail(db_mod != NULL);
-	return_if_fail(db_mod->db_close != NULL);
+	return_val_if_fail(db_mod != NULL, false);
+	return_val_if_fail(db_mod->db_close != NULL, false);
 
 	return db_mod->db_close(db);
 }
@@ -34,7 +60,8 @@ db_parse(database_handle_t *db)
 	return_if_fail(db_mod != NULL);
 	return_if_fail(db_mod->db_parse != NULL);
 
-	return db_mod->db_parse(db);
+	db_mod->db_parse(db);
+	db_log_stats(db);
 }
 
 bool
@@ -235,45 +262,238 @@ db_commit_row(database_handle_t *db)
 	return_val_if_fail(db->vt != NULL, false);
 	return_val_if_fail(db->vt->commit_row != NULL, false);
 
+	db_rows_written++;
 	return db->vt->commit_row(db);
 }
 
+/* The memos, memo ignores, access list and metadata of an account are its
+ * cold data, which a backend may keep in a separate section of the database
+ * and only load when needed, see myuser_load_cold().  Returns false if the
+ * backend does not do so; the caller must then load the account's cold
+ * data and write it out as usual.  Otherwise the rows written up to
+ * db_end_cold() go into the cold section, and if the cold data of the
+ * account has not been loaded yet, the backend copies it over itself.
+ */
+bool
+db_start_cold(database_handle_t *db, myuser_t *mu)
+{
+	return_val_if_fail(db != NULL, false);
+	return_val_if_fail(db->vt != NULL, false);
+
+	if (db->vt->start_cold == NULL)
+		return false;
+
+	return db->vt->start_cold(db, mu);
+}
+
+void
+db_end_cold(database_handle_t *db)
+{
+	return_if_fail(db != NULL);
+	return_if_fail(db->vt != NULL);
+
+	if (db->vt->end_cold != NULL)
+		db->vt->end_cold(db);
+}
+
+static unsigned int
+db_type_hashval(const char *type)
+{
+	unsigned int h = 2166136261U;
+
+	for (; *type != '\0'; type++)
+		h = (h ^ toupper((unsigned char)*type)) * 16777619U;
+
+	return h;
+}
+
+static void
+db_type_hash_insert(database_type_t *t)
+{
+	unsigned int i;
+
+	for (i = db_type_hashval(t->name) & (db_type_hashsize - 1); db_type_hash[i] != 0; i = (i + 1) & (db_type_hashsize - 1))
+		;
+
+	db_type_hash[i] = t->id;
+}
+
+static void
+db_type_hash_grow(void)
+{
+	unsigned int i;
+
+	db_type_hashsize = db_type_hashsize ? db_type_hashsize * 2 : 256;
+	free(db_type_hash);
+	db_type_hash = scalloc(db_type_hashsize, sizeof(unsigned int));
+
+	for (i = 1; i < db_type_count; i++)
+		db_type_hash_insert(db_type_table[i]);
+}
+
+static database_type_t *
+db_type_find(const char *type)
+{
+	database_type_t *t;
+	unsigned int i;
+
+	if (db_type_last != NULL && !strcmp(db_type_last->name, type))
+		return db_type_last;
+
+	if (db_type_hash == NULL)
+		return NULL;
+
+	for (i = db_type_hashval(type) & (db_type_hashsize - 1); db_type_hash[i] != 0; i = (i + 1) & (db_type_hashsize - 1))
+	{
+		t = db_type_table[db_type_hash[i]];
+
+		if (!strcasecmp(t->name, type))
+			return db_type_last = t;
+	}
+
+	return NULL;
+}
+
 void
 db_register_type_handler(const char *type, database_handler_f fun)
 {
+	database_type_t *t;
+
 	return_if_fail(db_types != NULL);
 	return_if_fail(type != NULL);
 	return_if_fail(fun != NULL);
 
-	mowgli_patricia_add(db_types, type, fun);
+	if ((t = mowgli_patricia_retrieve(db_types, type)) != NULL)
+	{
+		t->fun = fun;
+		return;
+	}
+
+	if (db_type_count == db_type_tablesize)
+	{
+		db_type_tablesize = db_type_tablesize ? db_type_tablesize * 2 : 64;
+		db_type_table = srealloc(db_type_table, db_type_tablesize * sizeof(database_type_t *));
+	}
+
+	t = scalloc(sizeof(database_type_t), 1);
+	t->name = sstrdup(type);
+	t->id = db_type_count++;
+	t->fun = fun;
+
+	db_type_table[t->id] = t;
+	mowgli_patricia_add(db_types, t->name, t);
+
+	/* keep the hash at most half full */
+	if (db_type_count * 2 > db_type_hashsize)
+		db_type_hash_grow();
+	else
+		db_type_hash_insert(t);
 }
 
 void
 db_unregister_type_handler(const char *type)
 {
+	database_type_t *t;
+
 	return_if_fail(db_types != NULL);
 	return_if_fail(type != NULL);
 
-	mowgli_patricia_delete(db_types, type);
+	if ((t = mowgli_patricia_retrieve(db_types, type)) != NULL)
+		t->fun = NULL;
+}
+
+unsigned int
+db_type_id(const char *type)
+{
+	database_type_t *t;
+
+	return_val_if_fail(type != NULL, 0);
+
+	t = db_type_find(type);
+	return t != NULL ? t->id : 0;
 }
 
 void
-db_process(database_handle_t *db, const char *type)
+db_process_id(database_handle_t *db, unsigned int id, const char *type)
 {
-	database_handler_f fun;
+	database_type_t *t;
+#ifdef HAVE_GETTIMEOFDAY
+	struct timeval now, tv;
+#endif
 
 	return_if_fail(db_types != NULL);
 	return_if_fail(db != NULL);
 	return_if_fail(type != NULL);
 
-	fun = mowgli_patricia_retrieve(db_types, type);
+	t = id < db_type_count ? db_type_table[id] : NULL;
+	if (t == NULL || t->fun == NULL)
+		t = db_type_find("???");
+	return_if_fail(t != NULL && t->fun != NULL);
 
-	if (!fun)
+	/* time is only charged to a type when the type changes */
+	if (t != db_type_timed)
 	{
-		fun = mowgli_patricia_retrieve(db_types, "???");
+#ifdef HAVE_GETTIMEOFDAY
+		s_time(&now);
+		if (db_type_timed != NULL)
+		{
+			timersub(&now, &db_type_mark, &tv);
+			timeradd(&db_type_timed->time, &tv, &db_type_timed->time);
+		}
+		db_type_mark = now;
+#endif
+		db_type_timed = t;
 	}
+	t->rows++;
+	db_rows_read++;
 
-	fun(db, type);
+	t->fun(db, type);
+}
+
+void
+db_process(database_handle_t *db, const char *type)
+{
+	return_if_fail(type != NULL);
+
+	db_process_id(db, db_type_id(type), type);
+}
+
+/* Logs how many rows of each type were loaded since the last call, and how
+ * long their handlers took, then resets the counters.
+ */
+void
+db_log_stats(database_handle_t *db)
+{
+	database_type_t *t;
+	unsigned int i;
+	int ms = 0;
+#ifdef HAVE_GETTIMEOFDAY
+	struct timeval now, tv;
+
+	if (db_type_timed != NULL)
+	{
+		s_time(&now);
+		timersub(&now, &db_type_mark, &tv);
+		timeradd(&db_type_timed->time, &tv, &db_type_timed->time);
+	}
+#endif
+	db_type_timed = NULL;
+
+	for (i = 1; i < db_type_count; i++)
+	{
+		t = db_type_table[i];
+		if (t->rows == 0)
+			continue;
+
+#ifdef HAVE_GETTIMEOFDAY
+		ms = tv2ms(&t->time);
+		t->time.tv_sec = t->time.tv_usec = 0;
+#endif
+
+		slog(LG_INFO, "db_log_stats(): %s: %-10s %8u rows in %6d ms (%u rows/sec)", db->file, t->name, t->rows, ms,
+				ms > 0 ? (unsigned int)((unsigned long long)t->rows * 1000 / ms) : t->rows);
+		t->rows = 0;
+	}
 }
 
 bool
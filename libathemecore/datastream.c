@@ -25,11 +25,14 @@
 #include "datastream.h"
 
 #define SENDQSIZE (4096 - 40)
+#define SENDQ_IOV 64			/* blocks written per writev() */
 
 #ifdef MOWGLI_OS_WIN
 # define EWOULDBLOCK	WSAEWOULDBLOCK
 # define EALREADY	WSAEALREADY
 # define ENOBUFS	WSAENOBUFS
+#else
+# include <sys/uio.h>
 #endif
 
 /* sendq struct */
@@ -40,36 +43,73 @@ struct sendq {
 	char buf[SENDQSIZE];
 };
 
-void sendq_add(connection_t * cptr, char *buf, size_t len)
+/* drained blocks go back here rather than to free() */
+static mowgli_heap_t *sendq_heap;
+
+static struct sendq *sendq_block_new(connection_t *cptr)
 {
-	mowgli_node_t *n;
 	struct sendq *sq;
-	size_t l;
-	int pos = 0;
 
-	return_if_fail(cptr != NULL);
+	if (sendq_heap == NULL)
+		sendq_heap = mowgli_heap_create(sizeof(struct sendq), 16, BH_NOW);
+
+	sq = mowgli_heap_alloc(sendq_heap);
+	sq->firstused = sq->firstfree = 0;
+	mowgli_node_add(sq, &sq->node, &cptr->sendq);
 
+	return sq;
+}
+
+static void sendq_block_free(connection_t *cptr, struct sendq *sq)
+{
+	mowgli_node_delete(&sq->node, &cptr->sendq);
+	mowgli_heap_free(sendq_heap, sq);
+}
+
+/* checks and counts len more bytes going into the sendq */
+static bool sendq_account(connection_t *cptr, size_t len, const char *caller)
+{
 	if (cptr->flags & (CF_DEAD | CF_SEND_EOF))
 	{
-		slog(LG_DEBUG, "sendq_add(): attempted to send to fd %d which is already dead", cptr->fd);
-		return;
+		slog(LG_DEBUG, "%s(): attempted to send to fd %d which is already dead", caller, cptr->fd);
+		return false;
 	}
 
-	if (len == 0)
-		return;
-
-	if (cptr->sendq_limit != 0 &&
-			MOWGLI_LIST_LENGTH(&cptr->sendq) * SENDQSIZE + len > cptr->sendq_limit)
+	if (cptr->sendq_limit != 0 && cptr->sendq_len + len > cptr->sendq_limit)
 	{
-		slog(LG_INFO, "sendq_add(): sendq limit exceeded on connection %s[%d]",
-				cptr->name, cptr->fd);
+		slog(LG_INFO, "%s(): sendq limit exceeded on connection %s[%d]",
+				caller, cptr->name, cptr->fd);
 		cptr->flags |= CF_DEAD;
-		return;
+		return false;
 	}
 
-	if (!sendq_nonempty(cptr))
+	/* a corked connection asks for writes when it is uncorked */
+	if (cptr->sendq_corked == 0 && !sendq_nonempty(cptr))
 		connection_setselect_write(cptr, sendq_flush);
 
+	cptr->sendq_len += len;
+	cptr->sendq_queued += len;
+	if (cptr->sendq_len > cptr->sendq_peak)
+		cptr->sendq_peak = cptr->sendq_len;
+
+	return true;
+}
+
+void sendq_add(connection_t * cptr, char *buf, size_t len)
+{
+	mowgli_node_t *n;
+	struct sendq *sq;
+	size_t l;
+	int pos = 0;
+
+	return_if_fail(cptr != NULL);
+
+	if (len == 0)
+		return;
+
+	if (!sendq_account(cptr, len, "sendq_add"))
+		return;
+
 	n = cptr->sendq.tail;
 	if (n != NULL)
 	{
@@ -85,9 +125,7 @@ void sendq_add(connection_t * cptr, char *buf, size_t len)
 
 	while (len > 0)
 	{
-		sq = smalloc(sizeof(struct sendq));
-		sq->firstused = sq->firstfree = 0;
-		mowgli_node_add(sq, &sq->node, &cptr->sendq);
+		sq = sendq_block_new(cptr);
 		l = SENDQSIZE - sq->firstfree;
 		if (l > len)
 			l = len;
@@ -98,6 +136,63 @@ void sendq_add(connection_t * cptr, char *buf, size_t len)
 	}
 }
 
+/*
+ * sendq_reserve(connection_t *cptr, size_t len)
+ *
+ * Makes room for up to len bytes at the end of the sendq, so a line can
+ * be formatted straight into it and then queued with sendq_commit().
+ *
+ * Inputs:
+ *     - a connection
+ *     - the most bytes that will be written, at most SENDQSIZE
+ *
+ * Outputs:
+ *     - where to write them, or NULL if the connection is dead
+ *
+ * Side Effects:
+ *     - a new sendq block may be allocated
+ */
+char *sendq_reserve(connection_t *cptr, size_t len)
+{
+	mowgli_node_t *n;
+	struct sendq *sq;
+
+	return_val_if_fail(cptr != NULL, NULL);
+	return_val_if_fail(len <= SENDQSIZE, NULL);
+
+	if (cptr->flags & (CF_DEAD | CF_SEND_EOF))
+		return NULL;
+
+	n = cptr->sendq.tail;
+	if (n != NULL)
+	{
+		sq = n->data;
+		if ((size_t)(SENDQSIZE - sq->firstfree) >= len)
+			return sq->buf + sq->firstfree;
+	}
+
+	sq = sendq_block_new(cptr);
+	return sq->buf;
+}
+
+/* queues len bytes written to the space from sendq_reserve() */
+void sendq_commit(connection_t *cptr, size_t len)
+{
+	struct sendq *sq;
+
+	return_if_fail(cptr != NULL);
+	return_if_fail(cptr->sendq.tail != NULL);
+
+	if (len == 0)
+		return;
+
+	if (!sendq_account(cptr, len, "sendq_commit"))
+		return;
+
+	sq = cptr->sendq.tail->data;
+	sq->firstfree += len;
+}
+
 void sendq_add_eof(connection_t * cptr)
 {
 	return_if_fail(cptr != NULL);
@@ -107,31 +202,100 @@ void sendq_add_eof(connection_t * cptr)
 		slog(LG_DEBUG, "sendq_add(): attempted to send to fd %d which is already dead", cptr->fd);
 		return;
 	}
-	if (!sendq_nonempty(cptr))
+	if (cptr->sendq_corked == 0 && !sendq_nonempty(cptr))
 		connection_setselect_write(cptr, sendq_flush);
 	cptr->flags |= CF_SEND_EOF;
 }
 
-void sendq_flush(connection_t * cptr)
+/*
+ * sendq_cork(connection_t *cptr)
+ *
+ * Starts a batch of writes to a connection: until the matching
+ * sendq_uncork(), queueing data does not ask the event loop to
+ * watch the connection for writability.  Batches may nest.
+ *
+ * Inputs:
+ *     - a connection
+ *
+ * Outputs:
+ *     - none
+ *
+ * Side Effects:
+ *     - none
+ */
+void sendq_cork(connection_t *cptr)
 {
-        mowgli_node_t *n, *tn;
-        struct sendq *sq;
-        int l;
+	return_if_fail(cptr != NULL);
+
+	cptr->sendq_corked++;
+}
 
+/* ends a batch of writes, see sendq_cork() */
+void sendq_uncork(connection_t *cptr)
+{
 	return_if_fail(cptr != NULL);
+	return_if_fail(cptr->sendq_corked > 0);
+
+	/* a connection closed during the batch has empty_handler in place
+	 * of its handlers already; do not put sendq_flush back.
+	 */
+	if (--cptr->sendq_corked == 0 && !(cptr->flags & CF_DEAD) && sendq_nonempty(cptr))
+		connection_setselect_write(cptr, sendq_flush);
+}
+
+/* write out as many queued blocks as we can in one system call,
+ * returns the number of bytes written or -1 */
+static ssize_t sendq_write(connection_t *cptr, size_t *want)
+{
+#ifndef MOWGLI_OS_WIN
+	struct iovec iov[SENDQ_IOV];
+	mowgli_node_t *n;
+	struct sendq *sq;
+	int iovcnt = 0;
 
-        MOWGLI_ITER_FOREACH_SAFE(n, tn, cptr->sendq.head)
-        {
-                sq = (struct sendq *)n->data;
+	*want = 0;
+	MOWGLI_ITER_FOREACH(n, cptr->sendq.head)
+	{
+		sq = (struct sendq *)n->data;
+
+		if (iovcnt == SENDQ_IOV)
+			break;
+
+		iov[iovcnt].iov_base = sq->buf + sq->firstused;
+		iov[iovcnt].iov_len = sq->firstfree - sq->firstused;
+		*want += iov[iovcnt].iov_len;
+		iovcnt++;
+	}
+
+	cptr->sendq_syscalls++;
+
+	return writev(cptr->fd, iov, iovcnt);
+#else
+	struct sendq *sq = cptr->sendq.head->data;
+
+	*want = sq->firstfree - sq->firstused;
+	cptr->sendq_syscalls++;
+
+	return send(cptr->fd, sq->buf + sq->firstused, *want, 0);
+#endif
+}
+
+void sendq_flush(connection_t * cptr)
+{
+	mowgli_node_t *n, *tn;
+	struct sendq *sq;
+	ssize_t l;
+	size_t want, left, ll;
 
-                if (sq->firstused == sq->firstfree)
-                        break;
+	return_if_fail(cptr != NULL);
 
-                if ((l = send(cptr->fd, sq->buf + sq->firstused, sq->firstfree - sq->firstused, 0)) == -1)
-                {
-                        int err = ioerrno();
+	while (cptr->sendq_len > 0)
+	{
+		if ((l = sendq_write(cptr, &want)) == -1)
+		{
+			int err = ioerrno();
 
-                        if (!mowgli_eventloop_ignore_errno(err))
+			if (!mowgli_eventloop_ignore_errno(err))
 			{
 				slog(LG_DEBUG, "sendq_flush(): write error %d (%s) on connection %s[%d]",
 						err, strerror(err),
@@ -139,24 +303,37 @@ void sendq_flush(connection_t * cptr)
 				cptr->flags |= CF_DEAD;
 			}
 
-                        return;
-                }
+			return;
+		}
+
+		cptr->sendq_len -= l;
 
-                sq->firstused += l;
-                if (sq->firstused == sq->firstfree)
-                {
-			if (MOWGLI_LIST_LENGTH(&cptr->sendq) > 1)
+		/* give back the blocks that went out, the last one may
+		 * have gone out partially */
+		left = l;
+		MOWGLI_ITER_FOREACH_SAFE(n, tn, cptr->sendq.head)
+		{
+			sq = (struct sendq *)n->data;
+
+			if (left == 0)
+				break;
+
+			ll = sq->firstfree - sq->firstused;
+			if (left < ll)
 			{
-                        	mowgli_node_delete(&sq->node, &cptr->sendq);
-                        	free(sq);
+				sq->firstused += left;
+				break;
 			}
-			else
-				/* keep one struct sendq */
-				sq->firstused = sq->firstfree = 0;
-                }
-                else
-                        return;
-        }
+
+			left -= ll;
+			sendq_block_free(cptr, sq);
+		}
+
+		/* the socket is full, wait until it is writable again */
+		if ((size_t)l < want)
+			return;
+	}
+
 	if (cptr->flags & CF_SEND_EOF)
 	{
 		/* shut down write end, kill entire connection
@@ -173,18 +350,11 @@ void sendq_flush(connection_t * cptr)
 
 bool sendq_nonempty(connection_t *cptr)
 {
-	mowgli_node_t *n;
-	struct sendq *sq;
-
 	if (cptr->flags & CF_SEND_DEAD)
 		return false;
 	if (cptr->flags & CF_SEND_EOF)
 		return true;
-	n = cptr->sendq.head;
-	if (n == NULL)
-		return false;
-	sq = n->data;
-	return sq->firstfree > sq->firstused;
+	return cptr->sendq_len > 0;
 }
 
 void sendq_set_limit(connection_t *cptr, size_t len)
@@ -192,25 +362,81 @@ void sendq_set_limit(connection_t *cptr, size_t len)
 	cptr->sendq_limit = len;
 }
 
+/*
+ * The receive queue is a ring of RECVQSIZE bytes, followed by RECVQ_SLACK
+ * bytes where a line that wraps around the end of the ring is made whole
+ * again so it can be handed out in place.  recvq_head is the offset of
+ * the first unread byte and recvq_len the number of unread bytes.
+ */
+#define RECVQSIZE	16384		/* must be a power of two */
+#define RECVQ_SLACK	(BUFSIZE * 2)
+#define RECVQ_READS	8		/* recv() calls per read event */
+
+#define RECVQ_WRAP(x)	((x) & (RECVQSIZE - 1))
+
 int recvq_length(connection_t *cptr)
 {
-	int l = 0;
-	mowgli_node_t *n;
-	struct sendq *sq;
+	return cptr->recvq_len;
+}
+
+/* remove len bytes from the front of the receive queue */
+static void recvq_consume(connection_t *cptr, size_t len)
+{
+	cptr->recvq_len -= len;
+	if (cptr->recvq_len == 0)
+		cptr->recvq_head = 0;
+	else
+		cptr->recvq_head = RECVQ_WRAP(cptr->recvq_head + len);
+}
+
+/* length of the first line including its newline, 0 if there is
+ * no newline in the first len bytes */
+static size_t recvq_linelen(connection_t *cptr, size_t len)
+{
+	size_t first;
+	char *newline;
+
+	if (len > cptr->recvq_len)
+		len = cptr->recvq_len;
+	if (len == 0)
+		return 0;
+
+	first = RECVQSIZE - cptr->recvq_head;
+	if (first > len)
+		first = len;
+
+	newline = memchr(cptr->recvq + cptr->recvq_head, '\n', first);
+	if (newline != NULL)
+		return newline - (cptr->recvq + cptr->recvq_head) + 1;
+
+	if (first == len)
+		return 0;
+
+	newline = memchr(cptr->recvq, '\n', len - first);
+	if (newline != NULL)
+		return first + (newline - cptr->recvq) + 1;
+
+	return 0;
+}
+
+/* call the handler until it consumes nothing */
+static void recvq_dispatch(connection_t *cptr)
+{
+	size_t l;
 
-	MOWGLI_ITER_FOREACH(n, cptr->recvq.head)
+	while (cptr->recvq_handler != NULL && cptr->recvq_len != 0)
 	{
-		sq = n->data;
-		l += sq->firstfree - sq->firstused;
+		l = cptr->recvq_len;
+		cptr->recvq_handler(cptr);
+		if (cptr->recvq_len == l)
+			break;
 	}
-	return l;
 }
 
 void recvq_put(connection_t *cptr)
 {
-	mowgli_node_t *n;
-	struct sendq *sq = NULL;
-	int l, ll;
+	size_t tail, room;
+	int l, reads;
 
 	return_if_fail(cptr != NULL);
 
@@ -228,144 +454,167 @@ void recvq_put(connection_t *cptr)
 		return;
 	}
 
-	n = cptr->recvq.tail;
-	if (n != NULL)
-	{
-		sq = n->data;
-		l = SENDQSIZE - sq->firstfree;
-		if (l == 0)
-			sq = NULL;
-	}
-	if (sq == NULL)
-	{
-		sq = smalloc(sizeof(struct sendq));
-		sq->firstused = sq->firstfree = 0;
-		mowgli_node_add(sq, &sq->node, &cptr->recvq);
-		l = SENDQSIZE;
-	}
-	errno = 0;
+	if (cptr->recvq == NULL)
+		cptr->recvq = smalloc(RECVQSIZE + RECVQ_SLACK);
 
-	l = recv(cptr->fd, sq->buf + sq->firstfree, l, 0);
-	if (l == 0 || (l < 0 && !mowgli_eventloop_ignore_errno(ioerrno())))
+	/* read until the socket is drained, handing what we have to the
+	 * handler after each read, but give other connections a turn
+	 * after RECVQ_READS reads */
+	for (reads = 0; reads < RECVQ_READS; reads++)
 	{
-		if (l == 0)
-			slog(LG_DEBUG, "recvq_put(): fd %d closed the connection", cptr->fd);
+		if (cptr->recvq_len == RECVQSIZE)
+		{
+			slog(LG_DEBUG, "recvq_put(): recvq full on connection %s[%d]",
+					cptr->name, cptr->fd);
+			errno = 0;
+			connection_close(cptr);
+			return;
+		}
+
+		tail = cptr->recvq_head + cptr->recvq_len;
+		if (tail < RECVQSIZE)
+			room = RECVQSIZE - tail;
 		else
-			slog(LG_DEBUG, "recvq_put(): lost connection on fd %d", cptr->fd);
-		connection_close(cptr);
-		return;
-	}
-	else if (l > 0)
-		sq->firstfree += l;
+		{
+			tail -= RECVQSIZE;
+			room = cptr->recvq_head - tail;
+		}
 
-	if (cptr->recvq_handler)
-	{
-		l = recvq_length(cptr);
-		do /* call handler until it consumes nothing */
+		errno = 0;
+
+		l = recv(cptr->fd, cptr->recvq + tail, room, 0);
+		if (l == 0 || (l < 0 && !mowgli_eventloop_ignore_errno(ioerrno())))
 		{
-			cptr->recvq_handler(cptr);
-			ll = l;
-			l = recvq_length(cptr);
-		} while (ll != l && l != 0);
+			if (l == 0)
+				slog(LG_DEBUG, "recvq_put(): fd %d closed the connection", cptr->fd);
+			else
+				slog(LG_DEBUG, "recvq_put(): lost connection on fd %d", cptr->fd);
+			connection_close(cptr);
+			return;
+		}
+		else if (l < 0)
+			break;
+
+		cptr->recvq_len += l;
+
+		recvq_dispatch(cptr);
+
+		if (cptr->flags & CF_DEAD)
+			break;
 	}
-	return;
 }
 
 int recvq_get(connection_t *cptr, char *buf, size_t len)
 {
-	mowgli_node_t *n, *tn;
-	struct sendq *sq;
-	size_t l;
-	char *p = buf;
+	size_t first;
 
 	return_val_if_fail(cptr != NULL, 0);
 
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, cptr->recvq.head)
-	{
-		sq = (struct sendq *)n->data;
+	if (len > cptr->recvq_len)
+		len = cptr->recvq_len;
+	if (len == 0)
+		return 0;
 
-		if (sq->firstused == sq->firstfree || len <= 0)
-			break;
+	first = RECVQSIZE - cptr->recvq_head;
+	if (first > len)
+		first = len;
 
-		l = sq->firstfree - sq->firstused;
-		if (l > len)
-			l = len;
-		memcpy(p, sq->buf + sq->firstused, l);
+	memcpy(buf, cptr->recvq + cptr->recvq_head, first);
+	memcpy(buf + first, cptr->recvq, len - first);
 
-		p += l;
-		len -= l;
-		sq->firstused += l;
-		if (sq->firstused == sq->firstfree)
-		{
-			if (MOWGLI_LIST_LENGTH(&cptr->recvq) > 1)
-			{
-				mowgli_node_delete(&sq->node, &cptr->recvq);
-				free(sq);
-			}
-			else
-				/* keep one struct sendq */
-				sq->firstused = sq->firstfree = 0;
-		}
-		else
-			return p - buf;
-	}
-	return p - buf;
+	recvq_consume(cptr, len);
+
+	return len;
 }
 
 int recvq_getline(connection_t *cptr, char *buf, size_t len)
 {
-	mowgli_node_t *n, *tn;
-	struct sendq *sq, *sq2 = NULL;
-	size_t l = 0;
-	char *p = buf;
-	char *newline = NULL;
+	size_t l;
 
 	return_val_if_fail(cptr != NULL, 0);
 
-	MOWGLI_ITER_FOREACH(n, cptr->recvq.head)
+	l = recvq_linelen(cptr, len);
+	if (l != 0)
+		cptr->flags &= ~CF_NONEWLINE;
+	else if (cptr->recvq_len >= len && len > 0)
 	{
-		sq2 = n->data;
-		l += sq2->firstfree - sq2->firstused;
-		newline = memchr(sq2->buf + sq2->firstused, '\n', sq2->firstfree - sq2->firstused);
-		if (newline != NULL || l >= len)
-			break;
+		cptr->flags |= CF_NONEWLINE;
+		l = len;
 	}
-	if (newline == NULL && l < len)
+	else
 		return 0;
 
-	cptr->flags |= CF_NONEWLINE;
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, cptr->recvq.head)
-	{
-		sq = (struct sendq *)n->data;
+	return recvq_get(cptr, buf, l);
+}
 
-		if (sq->firstused == sq->firstfree || len <= 0)
-			break;
+/*
+ * recvq_getline_inplace(connection_t *cptr, char **line, size_t len)
+ *
+ * Takes the next line off the receive queue without copying it, like
+ * recvq_getline() but with the line left where it is.
+ *
+ * Inputs:
+ *     - a connection
+ *     - where to store a pointer to the line
+ *     - the maximum line length, at most RECVQ_SLACK - 1
+ *
+ * Outputs:
+ *     - the number of bytes taken off the queue, 0 if there is no
+ *       complete line yet
+ *
+ * Side Effects:
+ *     - *line is set to the line, with its CR/LF stripped and
+ *       NUL-terminated; it may be modified and stays valid until the
+ *       receive queue is used again
+ *     - CF_NONEWLINE is set if the line was cut at len bytes
+ */
+int recvq_getline_inplace(connection_t *cptr, char **line, size_t len)
+{
+	size_t l, first, end;
+	char *p;
 
-		l = sq->firstfree - sq->firstused;
-		if (l > len)
-			l = len;
-		if (sq == sq2 && l >= (size_t) (newline - sq->buf - sq->firstused + 1))
-			cptr->flags &= ~CF_NONEWLINE, l = newline - sq->buf - sq->firstused + 1;
-		memcpy(p, sq->buf + sq->firstused, l);
+	return_val_if_fail(cptr != NULL, 0);
+	return_val_if_fail(line != NULL, 0);
 
-		p += l;
-		len -= l;
-		sq->firstused += l;
-		if (sq->firstused == sq->firstfree)
-		{
-			if (MOWGLI_LIST_LENGTH(&cptr->recvq) > 1)
-			{
-				mowgli_node_delete(&sq->node, &cptr->recvq);
-				free(sq);
-			}
-			else
-				/* keep one struct sendq */
-				sq->firstused = sq->firstfree = 0;
-		}
-		else
-			return p - buf;
+	if (len > RECVQ_SLACK - 1)
+		len = RECVQ_SLACK - 1;
+
+	l = recvq_linelen(cptr, len);
+	if (l != 0)
+		cptr->flags &= ~CF_NONEWLINE;
+	else if (cptr->recvq_len >= len && len > 0)
+	{
+		cptr->flags |= CF_NONEWLINE;
+		l = len;
 	}
-	return p - buf;
+	else
+		return 0;
+
+	p = cptr->recvq + cptr->recvq_head;
+	first = RECVQSIZE - cptr->recvq_head;
+
+	/* join a wrapped line up in the slack after the ring; the cut off
+	 * part of a too long line also goes there, so terminating it
+	 * does not clobber the byte after it */
+	if (l > first)
+		memcpy(cptr->recvq + RECVQSIZE, cptr->recvq, l - first);
+	else if (cptr->flags & CF_NONEWLINE && l < first)
+	{
+		memcpy(cptr->recvq + RECVQSIZE, p, l);
+		p = cptr->recvq + RECVQSIZE;
+	}
+
+	recvq_consume(cptr, l);
+
+	end = l;
+	if (!(cptr->flags & CF_NONEWLINE))
+		end--;
+	if (end > 0 && p[end - 1] == '\r')
+		end--;
+	p[end] = '\0';
+	*line = p;
+
+	return l;
 }
 
 void sendqrecvq_free(connection_t *cptr)
@@ -373,21 +622,17 @@ void sendqrecvq_free(connection_t *cptr)
 	mowgli_node_t *nptr, *nptr2;
 	struct sendq *sq;
 
-	MOWGLI_ITER_FOREACH_SAFE(nptr, nptr2, cptr->recvq.head)
-	{
-		sq = nptr->data;
-
-		mowgli_node_delete(&sq->node, &cptr->recvq);
-		free(sq);
-	}
+	free(cptr->recvq);
+	cptr->recvq = NULL;
+	cptr->recvq_head = cptr->recvq_len = 0;
 
 	MOWGLI_ITER_FOREACH_SAFE(nptr, nptr2, cptr->sendq.head)
 	{
 		sq = nptr->data;
 
-		mowgli_node_delete(&sq->node, &cptr->sendq);
-		free(sq);
+		sendq_block_free(cptr, sq);
 	}
+	cptr->sendq_len = 0;
 }
 
 /* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
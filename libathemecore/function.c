@@ -304,12 +304,7 @@ static void canonicalize_emails(void)
 	myentity_t *mt;
 
 	MYENTITY_FOREACH_T(mt, &state, ENT_USER)
-	{
-		myuser_t *mu = user(mt);
-
-		strshare_unref(mu->email_canonical);
-		mu->email_canonical = canonicalize_email(mu->email);
-	}
+		myuser_canonicalize_email(user(mt));
 }
 
 void
@@ -375,11 +370,7 @@ void canonicalize_email_case(char email[EMAILLEN + 1], void *user_data)
 bool email_within_limits(const char *email)
 {
 	mowgli_node_t *n;
-	myentity_iteration_state_t state;
-	myentity_t *mt;
-	unsigned int tcnt = 0;
-	stringref email_canonical;
-	bool result = true;
+	mowgli_list_t *l;
 
 	if (me.maxusers <= 0)
 		return true;
@@ -390,24 +381,9 @@ bool email_within_limits(const char *email)
 			return true;
 	}
 
-	email_canonical = canonicalize_email(email);
-
-	MYENTITY_FOREACH_T(mt, &state, ENT_USER)
-	{
-		myuser_t *mu = user(mt);
-
-		if (mu->email_canonical == email_canonical)
-			tcnt++;
-
-		/* optimization: if tcnt >= me.maxusers, quit iterating. -nenolod */
-		if (tcnt >= me.maxusers) {
-			result = false;
-			break;
-		}
-	}
+	l = myuser_find_email(email);
 
-	strshare_unref(email_canonical);
-	return result;
+	return l == NULL || MOWGLI_LIST_LENGTH(l) < me.maxusers;
 }
 
 bool validhostmask(const char *host)
@@ -0,0 +1,348 @@
+/*
+ * atheme-services: A collection of minimalist IRC services
+ * hostmatch.c: Precompiled hostmask matching.
+ *
+ * Copyright (c) 2026 Atheme Development Group
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atheme.h"
+
+/*
+ * A hostmatch_t is a mask prepared for matching many names against it.
+ *
+ * Masks made of literal text and '*' only, which is almost all bans,
+ * access entries and K-lines, are split at the stars into case-folded
+ * segments: the first and last are anchored to the ends of the name
+ * unless the mask starts or ends with a star, and the ones in between
+ * are found left to right.  Masks using '?', '&', '#', '%' or '\' are
+ * left to match().  The CIDR part of the mask, if any, is parsed once
+ * for hostmatch_cidr() and hostmatch_ips().
+ */
+
+#define HM_ANY		0	/* only stars, matches everything */
+#define HM_EXACT	1	/* no wildcards at all */
+#define HM_STARS	2	/* literal segments and stars */
+#define HM_GLOB		3	/* anything else, see match() */
+
+struct hostmatch_
+{
+	int type;
+	char *mask;
+
+	/* HM_EXACT and HM_STARS */
+	char *folded;
+	unsigned int nsegs;
+	const char **segs;
+	size_t *seglens;
+	bool anchor_start, anchor_end;
+
+	/* mask is i/c, see match_ips() */
+	int ipslen;
+	bool ipsv6;
+	unsigned char ipsaddr[16];
+
+	/* mask is n!u@i/c, see match_cidr() */
+	int cidrlen;
+	bool cidrv6;
+	unsigned char cidraddr[16];
+	hostmatch_t *cidrnu;
+};
+
+static inline unsigned char hm_fold(unsigned char c)
+{
+	if (match_mapping == MATCH_ASCII)
+		return tolower(c);
+
+	return ToLowerTab[c];
+}
+
+static inline bool hm_equal(const char *name, const char *seg, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		if (hm_fold(name[i]) != (unsigned char)seg[i])
+			return false;
+
+	return true;
+}
+
+static void hostmatch_compile(hostmatch_t *hm)
+{
+	const char *p;
+	char *q;
+	unsigned int i;
+
+	if (strpbrk(hm->mask, "?&#%\\") != NULL)
+	{
+		hm->type = HM_GLOB;
+		return;
+	}
+
+	for (p = hm->mask; *p == '*'; p++)
+		;
+	if (*p == '\0' && p != hm->mask)
+	{
+		hm->type = HM_ANY;
+		return;
+	}
+
+	hm->type = strchr(hm->mask, '*') != NULL ? HM_STARS : HM_EXACT;
+	hm->anchor_start = hm->mask[0] != '*';
+	hm->anchor_end = *hm->mask == '\0' || hm->mask[strlen(hm->mask) - 1] != '*';
+
+	/* fold the mask and cut it up at the stars */
+	hm->folded = sstrdup(hm->mask);
+	hm->nsegs = 0;
+	for (q = hm->folded; *q != '\0'; q++)
+	{
+		*q = hm_fold(*q);
+		if (*q != '*' && (q == hm->folded || q[-1] == '*'))
+			hm->nsegs++;
+	}
+
+	if (hm->nsegs == 0)
+		return;
+
+	hm->segs = smalloc(hm->nsegs * sizeof(hm->segs[0]));
+	hm->seglens = smalloc(hm->nsegs * sizeof(hm->seglens[0]));
+
+	for (i = 0, q = hm->folded; *q != '\0'; )
+	{
+		if (*q == '*')
+		{
+			*q++ = '\0';
+			continue;
+		}
+
+		hm->segs[i] = q;
+		while (*q != '\0' && *q != '*')
+			q++;
+		hm->seglens[i] = q - hm->segs[i];
+		i++;
+	}
+}
+
+static void hostmatch_compile_cidr(hostmatch_t *hm)
+{
+	char nu[BUFSIZE];
+	const char *at;
+
+	at = strrchr(hm->mask, '@');
+	if (at == NULL)
+	{
+		hm->ipslen = cidr_parse(hm->mask, hm->ipsaddr, &hm->ipsv6);
+		return;
+	}
+
+	hm->cidrlen = cidr_parse(at + 1, hm->cidraddr, &hm->cidrv6);
+	if (hm->cidrlen == 0)
+		return;
+
+	mowgli_strlcpy(nu, hm->mask, sizeof nu);
+	if ((size_t)(at - hm->mask) < sizeof nu)
+		nu[at - hm->mask] = '\0';
+	hm->cidrnu = hostmatch_create(nu);
+}
+
+/*
+ * hostmatch_create(const char *mask)
+ *
+ * Prepares a mask for hostmatch(), hostmatch_cidr() and hostmatch_ips().
+ *
+ * Inputs:
+ *     - a mask as understood by match(), match_cidr() or match_ips()
+ *
+ * Outputs:
+ *     - a new hostmatch object, to be freed with hostmatch_destroy()
+ *
+ * Side Effects:
+ *     - none
+ */
+hostmatch_t *hostmatch_create(const char *mask)
+{
+	hostmatch_t *hm;
+
+	return_val_if_fail(mask != NULL, NULL);
+
+	hm = scalloc(1, sizeof(hostmatch_t));
+	hm->mask = sstrdup(mask);
+
+	hostmatch_compile(hm);
+
+	if (strchr(mask, '/') != NULL)
+		hostmatch_compile_cidr(hm);
+
+	return hm;
+}
+
+void hostmatch_destroy(hostmatch_t *hm)
+{
+	return_if_fail(hm != NULL);
+
+	if (hm->cidrnu != NULL)
+		hostmatch_destroy(hm->cidrnu);
+
+	free(hm->segs);
+	free(hm->seglens);
+	free(hm->folded);
+	free(hm->mask);
+	free(hm);
+}
+
+/*
+ * hostmatch(const hostmatch_t *hm, const char *name)
+ *
+ * Matches a name against a prepared mask, like match(hm's mask, name)
+ * but without re-reading the mask.
+ *
+ * Inputs:
+ *     - a prepared mask
+ *     - the name to match
+ *
+ * Outputs:
+ *     - 0 if the name matches, 1 if it does not
+ *
+ * Side Effects:
+ *     - none
+ */
+int hostmatch(const hostmatch_t *hm, const char *name)
+{
+	size_t namelen, pos, limit, len;
+	unsigned int i, last;
+
+	if (hm == NULL || name == NULL)
+		return 1;
+
+	switch (hm->type)
+	{
+	case HM_ANY:
+		return 0;
+	case HM_GLOB:
+		return match(hm->mask, name);
+	case HM_EXACT:
+		if (hm->nsegs == 0)
+			return *name != '\0';
+		namelen = strlen(name);
+		return !(namelen == hm->seglens[0] && hm_equal(name, hm->segs[0], namelen));
+	}
+
+	namelen = strlen(name);
+	pos = 0;
+	i = 0;
+	last = hm->nsegs;
+	limit = namelen;
+
+	if (hm->anchor_start)
+	{
+		if (namelen < hm->seglens[0] || !hm_equal(name, hm->segs[0], hm->seglens[0]))
+			return 1;
+		pos = hm->seglens[0];
+		i++;
+	}
+
+	if (hm->anchor_end)
+	{
+		last--;
+		len = hm->seglens[last];
+		if (namelen < pos + len || !hm_equal(name + namelen - len, hm->segs[last], len))
+			return 1;
+		limit = namelen - len;
+	}
+
+	/* the segments between stars match at their leftmost place */
+	for (; i < last; i++)
+	{
+		len = hm->seglens[i];
+
+		while (pos + len <= limit && !hm_equal(name + pos, hm->segs[i], len))
+			pos++;
+		if (pos + len > limit)
+			return 1;
+		pos += len;
+	}
+
+	return 0;
+}
+
+/*
+ * hostmatch_cidr(const hostmatch_t *hm, const char *address)
+ *
+ * Like match_cidr(hm's mask, address).
+ *
+ * Inputs:
+ *     - a prepared n!u@i/c mask
+ *     - an n!u@i address
+ *
+ * Outputs:
+ *     - 0 if the address matches, 1 if it does not
+ *
+ * Side Effects:
+ *     - none
+ */
+int hostmatch_cidr(const hostmatch_t *hm, const char *address)
+{
+	char nu[NICKLEN + USERLEN + HOSTLEN + 6];
+	const char *at;
+
+	if (hm == NULL || address == NULL || hm->cidrlen == 0)
+		return 1;
+
+	at = strrchr(address, '@');
+	if (at == NULL)
+		return 1;
+
+	if (cidr_match(hm->cidraddr, hm->cidrlen, hm->cidrv6, at + 1))
+		return 1;
+
+	mowgli_strlcpy(nu, address, sizeof nu);
+	if ((size_t)(at - address) < sizeof nu)
+		nu[at - address] = '\0';
+
+	return hostmatch(hm->cidrnu, nu);
+}
+
+/*
+ * hostmatch_ips(const hostmatch_t *hm, const char *address)
+ *
+ * Like match_ips(hm's mask, address).
+ *
+ * Inputs:
+ *     - a prepared i/c mask
+ *     - an IP address
+ *
+ * Outputs:
+ *     - 0 if the address matches, 1 if it does not
+ *
+ * Side Effects:
+ *     - none
+ */
+int hostmatch_ips(const hostmatch_t *hm, const char *address)
+{
+	if (hm == NULL || address == NULL)
+		return 1;
+
+	return cidr_match(hm->ipsaddr, hm->ipslen, hm->ipsv6, address);
+}
+
+/* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
+ * vim:ts=8
+ * vim:sw=8
+ * vim:noexpandtab
+ */
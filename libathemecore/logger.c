@@ -490,6 +490,40 @@ bool log_debug_enabled(void)
 	return false;
 }
 
+/*
+ * log_level_enabled(unsigned int level)
+ *
+ * Determines whether a message logged at the given level would be written
+ * anywhere, so callers can skip building messages that would not be.
+ *
+ * Inputs:
+ *       - a bitmask of log categories
+ *
+ * Outputs:
+ *       - boolean
+ *
+ * Side Effects:
+ *       - none
+ */
+bool log_level_enabled(unsigned int level)
+{
+	mowgli_node_t *n;
+	logfile_t *lf;
+
+	if (log_force)
+		return true;
+	if (runflags & (RF_LIVE | RF_STARTING) &&
+			(log_file != NULL ? log_file->log_mask : LG_ERROR | LG_INFO) & level)
+		return true;
+	MOWGLI_ITER_FOREACH(n, log_files.head)
+	{
+		lf = n->data;
+		if (lf->log_mask & level)
+			return true;
+	}
+	return false;
+}
+
 /*
  * log_master_set_mask(unsigned int mask)
  *
@@ -696,7 +696,7 @@ char *regex_extract(char *pattern, char **pend, int *pflags)
  *  `preg' is the regex to check with, `string' needs to be checked against.
  *  Returns `true' on match, `false' else.
  */
-bool regex_match(atheme_regex_t *preg, char *string)
+bool regex_match(atheme_regex_t *preg, const char *string)
 {
 	if (preg == NULL || string == NULL)
 	{
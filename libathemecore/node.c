@@ -33,6 +33,19 @@ mowgli_heap_t *kline_heap;	/* 16 */
 mowgli_heap_t *xline_heap;	/* 16 */
 mowgli_heap_t *qline_heap;	/* 16 */
 
+/* K-lines are indexed by host so that kline_find_user() does not have to
+ * try all of them: those on an exact host or IP are kept in lists by
+ * host, those on a CIDR mask in lists in a radix tree, and only the ones
+ * with wildcards are tried one by one.  They are also hashed by number
+ * for kline_find_num().
+ */
+static mowgli_patricia_t *kline_hosts;
+static cidrtree_t *kline_cidrs;
+static mowgli_list_t kline_wild;
+
+static kline_t **kline_nums;
+static unsigned int kline_numsize;
+
 /*************
  * L I S T S *
  *************/
@@ -49,6 +62,9 @@ void init_nodes(void)
 		exit(EXIT_FAILURE);
 	}
 
+	kline_hosts = mowgli_patricia_create(irccasecanon);
+	kline_cidrs = cidrtree_create();
+
 	init_uplinks();
 	init_servers();
 	init_metadata();
@@ -119,6 +135,102 @@ void remove_illegals()
  * K L I N E *
  *************/
 
+static inline unsigned int kline_numhash(unsigned long number)
+{
+	return ((unsigned int)number * 2654435761U) & (kline_numsize - 1);
+}
+
+static void kline_num_resize(unsigned int size)
+{
+	kline_t **old = kline_nums, *k, *next;
+	unsigned int oldsize = kline_numsize, i, h;
+
+	kline_nums = scalloc(size, sizeof(kline_t *));
+	kline_numsize = size;
+
+	for (i = 0; i < oldsize; i++)
+	{
+		for (k = old[i]; k != NULL; k = next)
+		{
+			next = k->numnext;
+			h = kline_numhash(k->number);
+			k->numnext = kline_nums[h];
+			kline_nums[h] = k;
+		}
+	}
+
+	free(old);
+}
+
+/* the list of K-lines k belongs in, see kline_find_user() */
+static mowgli_list_t *kline_index_list(kline_t *k, bool create)
+{
+	unsigned char addr[16];
+	mowgli_list_t *l;
+	bool v6;
+
+	if (strpbrk(k->host, "*?&#%\\") != NULL)
+		return &kline_wild;
+
+	if (strchr(k->host, '/') != NULL && cidr_parse(k->host, addr, &v6) != 0)
+	{
+		l = cidrtree_find(kline_cidrs, k->host);
+		if (l == NULL && create)
+		{
+			l = mowgli_list_create();
+			cidrtree_add(kline_cidrs, k->host, l);
+		}
+		return l;
+	}
+
+	l = mowgli_patricia_retrieve(kline_hosts, k->host);
+	if (l == NULL && create)
+	{
+		l = mowgli_list_create();
+		mowgli_patricia_add(kline_hosts, k->host, l);
+	}
+	return l;
+}
+
+static void kline_index_add(kline_t *k)
+{
+	mowgli_node_add(k, &k->inode, kline_index_list(k, true));
+
+	if (klnlist.count > kline_numsize)
+		kline_num_resize(kline_numsize != 0 ? kline_numsize * 2 : 256);
+
+	k->numnext = kline_nums[kline_numhash(k->number)];
+	kline_nums[kline_numhash(k->number)] = k;
+}
+
+static void kline_index_delete(kline_t *k)
+{
+	mowgli_list_t *l = kline_index_list(k, false);
+	kline_t **kp;
+
+	return_if_fail(l != NULL);
+
+	mowgli_node_delete(&k->inode, l);
+
+	if (l != &kline_wild && MOWGLI_LIST_LENGTH(l) == 0)
+	{
+		if (strchr(k->host, '/') != NULL && cidrtree_find(kline_cidrs, k->host) == l)
+			cidrtree_delete(kline_cidrs, k->host);
+		else
+			mowgli_patricia_delete(kline_hosts, k->host);
+		mowgli_list_free(l);
+	}
+
+	for (kp = &kline_nums[kline_numhash(k->number)]; *kp != NULL; kp = &(*kp)->numnext)
+	{
+		if (*kp == k)
+		{
+			*kp = k->numnext;
+			break;
+		}
+	}
+}
+
 kline_t *kline_add_with_id(const char *user, const char *host, const char *reason, long duration, const char *setby, unsigned long id)
 {
 	kline_t *k;
@@ -132,6 +244,8 @@ kline_t *kline_add_with_id(const char *user, const char *host, const char *reaso
 
 	k->user = sstrdup(user);
 	k->host = sstrdup(host);
+	k->usermatcher = hostmatch_create(user);
+	k->hostmatcher = hostmatch_create(host);
 	k->reason = sstrdup(reason);
 	k->setby = sstrdup(setby);
 	k->duration = duration;
@@ -139,6 +253,8 @@ kline_t *kline_add_with_id(const char *user, const char *host, const char *reaso
 	k->expires = CURRTIME + duration;
 	k->number = id;
 
+	kline_index_add(k);
+
 	cnt.kline++;
 
 
@@ -148,6 +264,8 @@ kline_t *kline_add_with_id(const char *user, const char *host, const char *reaso
 	if (me.connected)
 		kline_sts("*", user, host, duration, treason);
 
+	hook_call_kline_add(k);
+
 	return k;
 }
 
@@ -171,6 +289,8 @@ void kline_delete(kline_t *k)
 
 	slog(LG_DEBUG, "kline_delete(): %s@%s -> %s", k->user, k->host, k->reason);
 
+	hook_call_kline_delete(k);
+
 	/* only unkline if ircd has not already removed this -- jilles */
 	if (me.connected && (k->duration == 0 || k->expires > CURRTIME))
 		unkline_sts("*", k->user, k->host);
@@ -179,6 +299,10 @@ void kline_delete(kline_t *k)
 	mowgli_node_delete(n, &klnlist);
 	mowgli_node_free(n);
 
+	kline_index_delete(k);
+
+	hostmatch_destroy(k->usermatcher);
+	hostmatch_destroy(k->hostmatcher);
 	free(k->user);
 	free(k->host);
 	free(k->reason);
@@ -208,12 +332,12 @@ kline_t *kline_find(const char *user, const char *host)
 kline_t *kline_find_num(unsigned long number)
 {
 	kline_t *k;
-	mowgli_node_t *n;
 
-	MOWGLI_ITER_FOREACH(n, klnlist.head)
-	{
-		k = (kline_t *)n->data;
+	if (kline_numsize == 0)
+		return NULL;
 
+	for (k = kline_nums[kline_numhash(number)]; k != NULL; k = k->numnext)
+	{
 		if (k->number == number)
 			return k;
 	}
@@ -221,24 +345,47 @@ kline_t *kline_find_num(unsigned long number)
 	return NULL;
 }
 
-kline_t *kline_find_user(user_t *u)
+static void *kline_find_user_in(void *list, void *user)
 {
+	mowgli_list_t *l = list;
+	user_t *u = user;
 	kline_t *k;
 	mowgli_node_t *n;
 
-	MOWGLI_ITER_FOREACH(n, klnlist.head)
+	if (l == NULL)
+		return NULL;
+
+	MOWGLI_ITER_FOREACH(n, l->head)
 	{
 		k = (kline_t *)n->data;
 
 		if (k->duration != 0 && k->expires <= CURRTIME)
 			continue;
-		if (!match(k->user, u->user) && (!match(k->host, u->host) || !match(k->host, u->ip) || !match_ips(k->host, u->ip)))
+		if (!hostmatch(k->usermatcher, u->user) && (!hostmatch(k->hostmatcher, u->host) || !hostmatch(k->hostmatcher, u->ip) || !hostmatch_ips(k->hostmatcher, u->ip)))
 			return k;
 	}
 
 	return NULL;
 }
 
+kline_t *kline_find_user(user_t *u)
+{
+	kline_t *k;
+
+	if ((k = kline_find_user_in(mowgli_patricia_retrieve(kline_hosts, u->host), u)) != NULL)
+		return k;
+
+	if (u->ip != NULL)
+	{
+		if (irccasecmp(u->ip, u->host) && (k = kline_find_user_in(mowgli_patricia_retrieve(kline_hosts, u->ip), u)) != NULL)
+			return k;
+		if ((k = cidrtree_search_all(kline_cidrs, u->ip, kline_find_user_in, u)) != NULL)
+			return k;
+	}
+
+	return kline_find_user_in(&kline_wild, u);
+}
+
 void kline_expire(void *arg)
 {
 	kline_t *k;
@@ -180,7 +180,8 @@ void object_unref(void *obj)
 void object_dispose(void *object)
 {
 	object_t *obj;
-	mowgli_patricia_t *privatedata, *metadata;
+	mowgli_patricia_t *privatedata;
+	metadata_t **metadata;
 
 	return_if_fail(object != NULL);
 	obj = object(object);
@@ -212,23 +213,61 @@ void object_dispose(void *object)
 	if (privatedata != NULL)
 		mowgli_patricia_destroy(privatedata, NULL, NULL);
 
-	if (metadata != NULL)
-		mowgli_patricia_destroy(metadata, NULL, NULL);
+	free(metadata);
+}
+
+/* the metadata of an account may still be in the database */
+static inline void metadata_load(void *target)
+{
+	if (object(target)->destructor == (destructor_t) myuser_delete)
+		myuser_load_cold(target);
+}
+
+/*
+ * An object's metadata is a vector of pointers sorted by name, which is
+ * only allocated once the object has some.  Objects have a handful of
+ * entries at most, so it is grown one entry at a time and searched by
+ * bisection.  Names are shared strings, so that the same name on many
+ * objects is stored once.
+ */
+static bool metadata_search(object_t *obj, const char *name, unsigned int *pos)
+{
+	unsigned int lo = 0, hi = obj->nmetadata, mid;
+	int cmp;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		cmp = obj->metadata[mid]->name == name ? 0 : strcasecmp(name, obj->metadata[mid]->name);
+
+		if (cmp == 0)
+		{
+			*pos = mid;
+			return true;
+		}
+
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	*pos = lo;
+	return false;
 }
 
 metadata_t *metadata_add(void *target, const char *name, const char *value)
 {
 	object_t *obj;
 	metadata_t *md;
+	unsigned int pos;
 
 	return_val_if_fail(name != NULL, NULL);
 	return_val_if_fail(value != NULL, NULL);
 
+	metadata_load(target);
 	obj = object(target);
 
-	if (obj->metadata == NULL)
-		obj->metadata = mowgli_patricia_create(strcasecanon);
-
 	if (metadata_find(target, name))
 		metadata_delete(target, name);
 
@@ -237,7 +276,17 @@ metadata_t *metadata_add(void *target, const char *name, const char *value)
 	md->name = strshare_get(name);
 	md->value = sstrdup(value);
 
-	mowgli_patricia_add(obj->metadata, md->name, md);
+	metadata_search(obj, md->name, &pos);
+	obj->metadata = srealloc(obj->metadata, (obj->nmetadata + 1) * sizeof(metadata_t *));
+	memmove(&obj->metadata[pos + 1], &obj->metadata[pos], (obj->nmetadata - pos) * sizeof(metadata_t *));
+	obj->metadata[pos] = md;
+	obj->nmetadata++;
+
+	hook_call_metadata_add((&(hook_metadata_req_t){
+			.target = target,
+			.name = md->name,
+			.value = md->value
+		}));
 
 	return md;
 }
@@ -246,16 +295,24 @@ void metadata_delete(void *target, const char *name)
 {
 	object_t *obj;
 	metadata_t *md = metadata_find(target, name);
+	unsigned int pos;
 
 	if (!md)
 		return;
 
-	obj = object(target);
+	hook_call_metadata_delete((&(hook_metadata_req_t){
+			.target = target,
+			.name = md->name,
+			.value = md->value
+		}));
 
-	if (obj->metadata == NULL)
-		obj->metadata = mowgli_patricia_create(strcasecanon);
+	obj = object(target);
 
-	mowgli_patricia_delete(obj->metadata, name);
+	if (metadata_search(obj, md->name, &pos))
+	{
+		obj->nmetadata--;
+		memmove(&obj->metadata[pos], &obj->metadata[pos + 1], (obj->nmetadata - pos) * sizeof(metadata_t *));
+	}
 
 	strshare_unref(md->name);
 	free(md->value);
@@ -266,33 +323,29 @@ void metadata_delete(void *target, const char *name)
 metadata_t *metadata_find(void *target, const char *name)
 {
 	object_t *obj;
+	unsigned int pos;
 
 	return_val_if_fail(target != NULL, NULL);
 	return_val_if_fail(name != NULL, NULL);
 
+	if (!myuser_metadata_is_hot(name))
+		metadata_load(target);
 	obj = object(target);
 
-	if (obj->metadata == NULL)
-		obj->metadata = mowgli_patricia_create(strcasecanon);
+	if (!metadata_search(obj, name, &pos))
+		return NULL;
 
-	return mowgli_patricia_retrieve(obj->metadata, name);
+	return obj->metadata[pos];
 }
 
 void metadata_delete_all(void *target)
 {
 	object_t *obj;
-	metadata_t *md;
-	mowgli_patricia_iteration_state_t state;
 
 	obj = object(target);
 
-	if (obj->metadata == NULL)
-		obj->metadata = mowgli_patricia_create(strcasecanon);
-
-	MOWGLI_PATRICIA_FOREACH(md, &state, obj->metadata)
-	{
-		metadata_delete(obj, md->name);
-	}
+	while (obj->nmetadata > 0)
+		metadata_delete(obj, obj->metadata[obj->nmetadata - 1]->name);
 }
 
 void *privatedata_get(void *target, const char *key)
@@ -35,24 +35,26 @@ mowgli_eventloop_timer_t *ping_uplink_timer = NULL;
 static void irc_recvq_handler(connection_t *cptr)
 {
 	bool wasnonl;
-	char parsebuf[BUFSIZE + 1];
+	char *line;
 	int count;
 
-	wasnonl = cptr->flags & CF_NONEWLINE ? true : false;
-	count = recvq_getline(cptr, parsebuf, sizeof parsebuf - 1);
-	if (count <= 0)
-		return;
-	cnt.bin += count;
-	/* ignore the excessive part of a too long line */
-	if (wasnonl)
-		return;
-	me.uplinkpong = CURRTIME;
-	if (parsebuf[count - 1] == '\n')
-		count--;
-	if (count > 0 && parsebuf[count - 1] == '\r')
-		count--;
-	parsebuf[count] = '\0';
-	parse(parsebuf);
+	/* parse every complete line we have, straight out of the recvq,
+	 * and send whatever that produces as one batch */
+	sendq_cork(cptr);
+	while (!(cptr->flags & CF_DEAD))
+	{
+		wasnonl = cptr->flags & CF_NONEWLINE ? true : false;
+		count = recvq_getline_inplace(cptr, &line, BUFSIZE);
+		if (count <= 0)
+			break;
+		cnt.bin += count;
+		/* ignore the excessive part of a too long line */
+		if (wasnonl)
+			continue;
+		me.uplinkpong = CURRTIME;
+		parse(line);
+	}
+	sendq_uncork(cptr);
 }
 
 static void ping_uplink(void *arg)
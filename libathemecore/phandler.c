@@ -305,22 +305,16 @@ mowgli_node_t *generic_next_matching_ban(channel_t *c, user_t *u, int type, mowg
 {
 	chanban_t *cb;
 	mowgli_node_t *n;
-	char hostbuf[NICKLEN+USERLEN+HOSTLEN];
-	char cloakbuf[NICKLEN+USERLEN+HOSTLEN];
-	char realbuf[NICKLEN+USERLEN+HOSTLEN];
-	char ipbuf[NICKLEN+USERLEN+HOSTLEN];
-
-	snprintf(hostbuf, sizeof hostbuf, "%s!%s@%s", u->nick, u->user, u->vhost);
-	snprintf(cloakbuf, sizeof cloakbuf, "%s!%s@%s", u->nick, u->user, u->chost);
-	snprintf(realbuf, sizeof realbuf, "%s!%s@%s", u->nick, u->user, u->host);
-	/* will be nick!user@ if ip unknown, doesn't matter */
-	snprintf(ipbuf, sizeof ipbuf, "%s!%s@%s", u->nick, u->user, u->ip);
+	const usermasks_t *um;
+
+	um = user_masks(u);
+
 	MOWGLI_ITER_FOREACH(n, first)
 	{
 		cb = n->data;
 
 		if (cb->type == type &&
-				(!match(cb->mask, hostbuf) || !match(cb->mask, cloakbuf) || !match(cb->mask, realbuf) || !match(cb->mask, ipbuf) || (ircd->flags & IRCD_CIDR_BANS && !match_cidr(cb->mask, ipbuf))))
+				(!hostmatch(cb->matcher, um->vhost) || !hostmatch(cb->matcher, um->chost) || !hostmatch(cb->matcher, um->host) || !hostmatch(cb->matcher, um->ip) || (ircd->flags & IRCD_CIDR_BANS && !hostmatch_cidr(cb->matcher, um->ip))))
 			return n;
 	}
 	return NULL;
@@ -330,14 +324,9 @@ mowgli_node_t *generic_next_matching_host_chanacs(mychan_t *mc, user_t *u, mowgl
 {
 	chanacs_t *ca;
 	mowgli_node_t *n;
-	char hostbuf[NICKLEN+USERLEN+HOSTLEN];
-	char hostbuf2[NICKLEN+USERLEN+HOSTLEN];
-	char ipbuf[NICKLEN+USERLEN+HOSTLEN];
+	const usermasks_t *um;
 
-	snprintf(hostbuf, sizeof hostbuf, "%s!%s@%s", u->nick, u->user, u->vhost);
-	snprintf(hostbuf2, sizeof hostbuf2, "%s!%s@%s", u->nick, u->user, u->chost);
-	/* will be nick!user@ if ip unknown, doesn't matter */
-	snprintf(ipbuf, sizeof ipbuf, "%s!%s@%s", u->nick, u->user, u->ip);
+	um = user_masks(u);
 
 	MOWGLI_ITER_FOREACH(n, first)
 	{
@@ -345,7 +334,7 @@ mowgli_node_t *generic_next_matching_host_chanacs(mychan_t *mc, user_t *u, mowgl
 
 		if (ca->entity != NULL)
 		       continue;
-		if (!match(ca->host, hostbuf) || !match(ca->host, hostbuf2) || !match(ca->host, ipbuf) || (ircd->flags & IRCD_CIDR_BANS && !match_cidr(ca->host, ipbuf)))
+		if (!hostmatch(ca->matcher, um->vhost) || !hostmatch(ca->matcher, um->chost) || !hostmatch(ca->matcher, um->ip) || (ircd->flags & IRCD_CIDR_BANS && !hostmatch_cidr(ca->matcher, um->ip)))
 			return n;
 	}
 	return NULL;
@@ -39,6 +39,137 @@ ircd_t *ircd;
 bool pmodule_loaded = false;
 bool backend_loaded = false;
 
+/*
+ * The tokens that make up nearly all of a burst and of normal traffic,
+ * for TS6, P10 and the others, have a slot each in pcommand_table and
+ * are told apart by length and first character; other tokens are
+ * looked up in the pcommands tree.
+ */
+enum pcommand_slot {
+	/* P10 */
+	PT_A, PT_B, PT_C, PT_D, PT_G, PT_J, PT_K, PT_L, PT_M, PT_N, PT_O,
+	PT_P, PT_Q, PT_S, PT_T, PT_Z, PT_EA, PT_EB, PT_OM, PT_SQ,
+	/* TS6 and others */
+	PT_TB, PT_SID, PT_UID, PT_AWAY, PT_EUID, PT_JOIN, PT_KICK, PT_KILL,
+	PT_MODE, PT_NICK, PT_PART, PT_PASS, PT_PING, PT_PONG, PT_QUIT,
+	PT_BMASK, PT_CAPAB, PT_ENCAP, PT_ERROR, PT_FJOIN, PT_FMODE, PT_SJOIN,
+	PT_SQUIT, PT_TMODE, PT_TOPIC, PT_FTOPIC, PT_NOTICE, PT_SERVER,
+	PT_CHGHOST, PT_PRIVMSG,
+	PT_COUNT
+};
+
+static const char *const pcommand_tokens[PT_COUNT] = {
+	[PT_A] = "A", [PT_B] = "B", [PT_C] = "C", [PT_D] = "D",
+	[PT_G] = "G", [PT_J] = "J", [PT_K] = "K", [PT_L] = "L",
+	[PT_M] = "M", [PT_N] = "N", [PT_O] = "O", [PT_P] = "P",
+	[PT_Q] = "Q", [PT_S] = "S", [PT_T] = "T", [PT_Z] = "Z",
+	[PT_EA] = "EA", [PT_EB] = "EB", [PT_OM] = "OM", [PT_SQ] = "SQ",
+	[PT_TB] = "TB", [PT_SID] = "SID", [PT_UID] = "UID",
+	[PT_AWAY] = "AWAY", [PT_EUID] = "EUID", [PT_JOIN] = "JOIN",
+	[PT_KICK] = "KICK", [PT_KILL] = "KILL", [PT_MODE] = "MODE",
+	[PT_NICK] = "NICK", [PT_PART] = "PART", [PT_PASS] = "PASS",
+	[PT_PING] = "PING", [PT_PONG] = "PONG", [PT_QUIT] = "QUIT",
+	[PT_BMASK] = "BMASK", [PT_CAPAB] = "CAPAB", [PT_ENCAP] = "ENCAP",
+	[PT_ERROR] = "ERROR", [PT_FJOIN] = "FJOIN", [PT_FMODE] = "FMODE",
+	[PT_SJOIN] = "SJOIN", [PT_SQUIT] = "SQUIT", [PT_TMODE] = "TMODE",
+	[PT_TOPIC] = "TOPIC", [PT_FTOPIC] = "FTOPIC", [PT_NOTICE] = "NOTICE",
+	[PT_SERVER] = "SERVER", [PT_CHGHOST] = "CHGHOST",
+	[PT_PRIVMSG] = "PRIVMSG",
+};
+
+static pcommand_t *pcommand_table[PT_COUNT];
+
+/* the command whose handler is running, see pcommand_exec() */
+static pcommand_t *pcommand_running;
+
+#define PT_TRY(slot) if (!strcmp(token, pcommand_tokens[slot])) return slot
+
+/* returns the slot for a token, or -1 if it has none */
+static int pcommand_slot(const char *token)
+{
+	switch (strlen(token))
+	{
+	case 1:
+		switch (*token)
+		{
+		case 'A': return PT_A;
+		case 'B': return PT_B;
+		case 'C': return PT_C;
+		case 'D': return PT_D;
+		case 'G': return PT_G;
+		case 'J': return PT_J;
+		case 'K': return PT_K;
+		case 'L': return PT_L;
+		case 'M': return PT_M;
+		case 'N': return PT_N;
+		case 'O': return PT_O;
+		case 'P': return PT_P;
+		case 'Q': return PT_Q;
+		case 'S': return PT_S;
+		case 'T': return PT_T;
+		case 'Z': return PT_Z;
+		}
+		break;
+	case 2:
+		switch (*token)
+		{
+		case 'E': PT_TRY(PT_EA); PT_TRY(PT_EB); break;
+		case 'O': PT_TRY(PT_OM); break;
+		case 'S': PT_TRY(PT_SQ); break;
+		case 'T': PT_TRY(PT_TB); break;
+		}
+		break;
+	case 3:
+		switch (*token)
+		{
+		case 'S': PT_TRY(PT_SID); break;
+		case 'U': PT_TRY(PT_UID); break;
+		}
+		break;
+	case 4:
+		switch (*token)
+		{
+		case 'A': PT_TRY(PT_AWAY); break;
+		case 'E': PT_TRY(PT_EUID); break;
+		case 'J': PT_TRY(PT_JOIN); break;
+		case 'K': PT_TRY(PT_KICK); PT_TRY(PT_KILL); break;
+		case 'M': PT_TRY(PT_MODE); break;
+		case 'N': PT_TRY(PT_NICK); break;
+		case 'P': PT_TRY(PT_PART); PT_TRY(PT_PASS); PT_TRY(PT_PING); PT_TRY(PT_PONG); break;
+		case 'Q': PT_TRY(PT_QUIT); break;
+		}
+		break;
+	case 5:
+		switch (*token)
+		{
+		case 'B': PT_TRY(PT_BMASK); break;
+		case 'C': PT_TRY(PT_CAPAB); break;
+		case 'E': PT_TRY(PT_ENCAP); PT_TRY(PT_ERROR); break;
+		case 'F': PT_TRY(PT_FJOIN); PT_TRY(PT_FMODE); break;
+		case 'S': PT_TRY(PT_SJOIN); PT_TRY(PT_SQUIT); break;
+		case 'T': PT_TRY(PT_TMODE); PT_TRY(PT_TOPIC); break;
+		}
+		break;
+	case 6:
+		switch (*token)
+		{
+		case 'F': PT_TRY(PT_FTOPIC); break;
+		case 'N': PT_TRY(PT_NOTICE); break;
+		case 'S': PT_TRY(PT_SERVER); break;
+		}
+		break;
+	case 7:
+		switch (*token)
+		{
+		case 'C': PT_TRY(PT_CHGHOST); break;
+		case 'P': PT_TRY(PT_PRIVMSG); break;
+		}
+		break;
+	}
+
+	return -1;
+}
+
 void pcommand_init(void)
 {
 	pcommand_heap = sharedheap_get(sizeof(pcommand_t));
@@ -55,6 +186,7 @@ void pcommand_init(void)
 void pcommand_add(const char *token, void (*handler) (sourceinfo_t *si, int parc, char *parv[]), int minparc, int sourcetype)
 {
 	pcommand_t *pcmd;
+	int slot;
 
 	if (pcommand_find(token))
 	{
@@ -69,11 +201,15 @@ void pcommand_add(const char *token, void (*handler) (sourceinfo_t *si, int parc
 	pcmd->sourcetype = sourcetype;
 
 	mowgli_patricia_add(pcommands, pcmd->token, pcmd);
+
+	if ((slot = pcommand_slot(token)) != -1)
+		pcommand_table[slot] = pcmd;
 }
 
 void pcommand_delete(const char *token)
 {
 	pcommand_t *pcmd;
+	int slot;
 
 	if (!(pcmd = pcommand_find(token)))
 	{
@@ -83,6 +219,11 @@ void pcommand_delete(const char *token)
 
 	mowgli_patricia_delete(pcommands, pcmd->token);
 
+	if ((slot = pcommand_slot(token)) != -1)
+		pcommand_table[slot] = NULL;
+	if (pcommand_running == pcmd)
+		pcommand_running = NULL;
+
 	free(pcmd->token);
 	pcmd->handler = NULL;
 	mowgli_heap_free(pcommand_heap, pcmd);
@@ -90,9 +231,64 @@ void pcommand_delete(const char *token)
 
 pcommand_t *pcommand_find(const char *token)
 {
+	int slot;
+
+	if ((slot = pcommand_slot(token)) != -1)
+		return pcommand_table[slot];
+
 	return mowgli_patricia_retrieve(pcommands, token);
 }
 
+/*
+ * pcommand_exec(pcommand_t *pcmd, sourceinfo_t *si, int parc, char *parv[])
+ *
+ * Runs the handler for a protocol command, counting the call and the
+ * time spent in it for STATS M.
+ *
+ * Inputs:
+ *     - the command, from pcommand_find()
+ *     - the source and parameters of the message
+ *
+ * Outputs:
+ *     - none
+ *
+ * Side Effects:
+ *     - whatever the handler does
+ */
+void pcommand_exec(pcommand_t *pcmd, sourceinfo_t *si, int parc, char *parv[])
+{
+	pcommand_t *outer;
+#ifdef HAVE_GETTIMEOFDAY
+	struct timeval start, elapsed;
+#endif
+
+	return_if_fail(pcmd != NULL);
+
+	if (pcmd->handler == NULL)
+		return;
+
+	outer = pcommand_running;
+	pcommand_running = pcmd;
+	pcmd->calls++;
+
+#ifdef HAVE_GETTIMEOFDAY
+	s_time(&start);
+#endif
+
+	pcmd->handler(si, parc, parv);
+
+	/* the handler may have deleted its own command */
+	if (pcommand_running == pcmd)
+	{
+#ifdef HAVE_GETTIMEOFDAY
+		e_time(start, &elapsed);
+		pcmd->usec += (unsigned long long)elapsed.tv_sec * 1000000 + elapsed.tv_usec;
+#endif
+	}
+
+	pcommand_running = outer;
+}
+
 /* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
  * vim:ts=8
  * vim:sw=8
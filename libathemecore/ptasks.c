@@ -98,6 +98,8 @@ void handle_stats(user_t *u, char req)
 	mowgli_node_t *n;
 	uplink_t *uplink;
 	soper_t *soper;
+	pcommand_t *pcmd;
+	mowgli_patricia_iteration_state_t state;
 	int j;
 	char fl[10];
 
@@ -202,6 +204,23 @@ void handle_stats(user_t *u, char req)
 
 		  break;
 
+	  case 'm':
+	  case 'M':
+		  if (!has_priv_user(u, PRIV_SERVER_AUSPEX))
+			  break;
+
+		  numeric_sts(me.me, 249, u, "M :%-8s %10s %12s %8s", "Command", "Calls", "Time (us)", "us/call");
+		  MOWGLI_PATRICIA_FOREACH(pcmd, &state, pcommands)
+		  {
+			  if (pcmd->calls == 0)
+				  continue;
+
+			  numeric_sts(me.me, 249, u, "M :%-8s %10lu %12llu %8llu",
+					  pcmd->token, pcmd->calls, pcmd->usec,
+					  pcmd->usec / pcmd->calls);
+		  }
+		  break;
+
 	  case 'o':
 	  case 'O':
 		  if (!has_priv_user(u, PRIV_VIEWPRIVS))
@@ -248,6 +267,12 @@ void handle_stats(user_t *u, char req)
 		  numeric_sts(me.me, 249, u, "T :myuser_nam %7d", cnt.myuser_name);
 		  numeric_sts(me.me, 249, u, "T :mychan     %7d", cnt.mychan);
 		  numeric_sts(me.me, 249, u, "T :chanacs    %7d", cnt.chanacs);
+		  numeric_sts(me.me, 249, u, "T :acs hits   %7u", cnt.chanacs_cache_hit);
+		  numeric_sts(me.me, 249, u, "T :acs misses %7u", cnt.chanacs_cache_miss);
+		  numeric_sts(me.me, 249, u, "T :strshare   %7u", cnt.strshare);
+		  numeric_sts(me.me, 249, u, "T :strs refs  %7u", cnt.strshare_refs);
+		  numeric_sts(me.me, 249, u, "T :strs bytes %7.2f%s", bytes(cnt.strshare_bytes), sbytes(cnt.strshare_bytes));
+		  numeric_sts(me.me, 249, u, "T :strs dedup %7.2f", cnt.strshare != 0 ? (double)cnt.strshare_refs / cnt.strshare : 0.0);
 
 #ifdef OBJECT_DEBUG
 		  numeric_sts(me.me, 249, u, "T :objects    %7zu", MOWGLI_LIST_LENGTH(&object_list));
@@ -29,7 +29,7 @@
 int sts(const char *fmt, ...)
 {
 	va_list ap;
-	char buf[513];
+	char *buf;
 	int len;
 
 	if (!me.connected)
@@ -39,24 +39,61 @@ int sts(const char *fmt, ...)
 	return_val_if_fail(curr_uplink->conn != NULL, 0);
 	return_val_if_fail(fmt != NULL, 0);
 
+	/* format straight into the sendq */
+	buf = sendq_reserve(curr_uplink->conn, 513);
+	if (buf == NULL)
+		return 0;
+
 	va_start(ap, fmt);
-	vsnprintf(buf, 511, fmt, ap); /* leave two bytes for \r\n */
+	len = vsnprintf(buf, 511, fmt, ap); /* leave two bytes for \r\n */
 	va_end(ap);
 
-	len = strlen(buf);
+	if (len < 0)
+		len = 0;
+	else if (len > 510)
+		len = 510;
 	buf[len++] = '\r';
 	buf[len++] = '\n';
-	buf[len] = '\0';
 
 	cnt.bout += len;
 
-	sendq_add(curr_uplink->conn, buf, len);
+	sendq_commit(curr_uplink->conn, len);
 
-	slog(LG_RAWDATA, "<- %.*s", len, buf);
+	if (log_level_enabled(LG_RAWDATA))
+		slog(LG_RAWDATA, "<- %.*s", len, buf);
 
 	return 0;
 }
 
+/*
+ * sts_batch_begin()
+ *
+ * Starts a batch of lines to the uplink, such as a burst of users or a
+ * run of mode changes; see sendq_cork().
+ *
+ * inputs:
+ *       none
+ *
+ * outputs:
+ *       none
+ *
+ * side effects:
+ *       writes to the uplink are not asked for until sts_batch_end()
+ */
+void sts_batch_begin(void)
+{
+	if (curr_uplink != NULL && curr_uplink->conn != NULL)
+		sendq_cork(curr_uplink->conn);
+}
+
+/* ends a batch started with sts_batch_begin(); the uplink may have been
+ * replaced in between, and a new connection was never corked */
+void sts_batch_end(void)
+{
+	if (curr_uplink != NULL && curr_uplink->conn != NULL && curr_uplink->conn->sendq_corked > 0)
+		sendq_uncork(curr_uplink->conn);
+}
+
 /*
  * io_loop()
  *
@@ -71,7 +71,7 @@ int remove_banlike(user_t *source, channel_t *chan, int type, user_t *target)
 	if (source == NULL || chan == NULL || target == NULL)
 		return 0;
 
-	for (n = next_matching_ban(chan, target, type, chan->bans.head); n != NULL; n = next_matching_ban(chan, target, type, tn))
+	for (n = next_matching_ban(chan, target, type, chanban_first(chan, type)); n != NULL; n = next_matching_ban(chan, target, type, tn))
 	{
 		tn = n->next;
 		cb = n->data;
@@ -248,6 +248,7 @@ void services_init(void)
 	service_t *svs;
 	mowgli_patricia_iteration_state_t state;
 
+	sts_batch_begin();
 	MOWGLI_PATRICIA_FOREACH(svs, &state, services_name)
 	{
 		if (ircd->uses_uid && svs->me->uid == NULL)
@@ -258,6 +259,7 @@ void services_init(void)
 			kill_id_sts(NULL, svs->nick, "Attempt to use service nick");
 		introduce_nick(svs->me);
 	}
+	sts_batch_end();
 
 	hook_add_event("user_can_login");
 }
@@ -461,6 +463,7 @@ void handle_burstlogin(user_t *u, const char *login, time_t ts)
 		ircd_on_logout(u, login);
 		return;
 	}
+	myuser_load_cold(mu);
 	u->myuser = mu;
 	u->flags &= ~UF_SOPER_PASS;
 	n = mowgli_node_create();
@@ -539,6 +542,7 @@ void handle_setlogin(sourceinfo_t *si, user_t *u, const char *login, time_t ts)
 				(unsigned long)ts);
 		mu->registered = ts;
 	}
+	myuser_load_cold(mu);
 	u->myuser = mu;
 	u->flags &= ~UF_SOPER_PASS;
 	n = mowgli_node_create();
@@ -637,6 +641,7 @@ void myuser_login(service_t *svs, user_t *u, myuser_t *mu, bool sendaccount)
 
 	myuser_notice(svs->me->nick, mu, "%s!%s@%s has just authenticated as you (%s)", u->nick, u->user, u->vhost, entity(mu)->name);
 
+	myuser_load_cold(mu);
 	u->myuser = mu;
 	mowgli_node_add(u, mowgli_node_create(), &mu->logins);
 	u->flags &= ~UF_SOPER_PASS;
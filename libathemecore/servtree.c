@@ -460,6 +460,7 @@ void servtree_update(void *dummy)
 			sptr->me->vhost = strshare_ref(sptr->me->host);
 			strshare_unref(sptr->me->gecos);
 			sptr->me->gecos = strshare_get(sptr->real);
+			user_mask_changed(sptr->me);
 			if (me.connected)
 				reintroduce_user(sptr->me);
 		}
@@ -23,38 +23,150 @@
 
 #include "atheme.h"
 
-mowgli_patricia_t *strshare_dict;
-
+/* Shared strings are kept in an open-addressed hash table, which is grown
+ * to stay at most half full.  Each string is stored right after its
+ * header, which caches its hash and length so that lookups compare
+ * little more than those.
+ */
 typedef struct
 {
 	int refcount;
+	unsigned int hash;
+	size_t len;
 } strshare_t;
 
+#define STRSHARE_MINSIZE	1024
+
+static strshare_t **strshare_table;
+static unsigned int strshare_size;
+
+static inline unsigned int strshare_hash(const char *str, size_t len)
+{
+	unsigned int h = 2166136261U;
+	size_t i;
+
+	/* FNV-1a */
+	for (i = 0; i < len; i++)
+	{
+		h ^= (unsigned char)str[i];
+		h *= 16777619U;
+	}
+
+	return h;
+}
+
+static void strshare_insert(strshare_t *ss)
+{
+	unsigned int i = ss->hash & (strshare_size - 1);
+
+	while (strshare_table[i] != NULL)
+		i = (i + 1) & (strshare_size - 1);
+
+	strshare_table[i] = ss;
+}
+
+static void strshare_resize(unsigned int size)
+{
+	strshare_t **old = strshare_table;
+	unsigned int oldsize = strshare_size, i;
+
+	strshare_table = scalloc(size, sizeof(strshare_t *));
+	strshare_size = size;
+
+	for (i = 0; i < oldsize; i++)
+		if (old[i] != NULL)
+			strshare_insert(old[i]);
+
+	free(old);
+}
+
+static void strshare_remove(strshare_t *ss)
+{
+	unsigned int mask = strshare_size - 1;
+	unsigned int i, j, k;
+
+	i = ss->hash & mask;
+	while (strshare_table[i] != ss)
+	{
+		return_if_fail(strshare_table[i] != NULL);
+		i = (i + 1) & mask;
+	}
+
+	/* move back entries which would no longer be found past the hole */
+	for (j = (i + 1) & mask; strshare_table[j] != NULL; j = (j + 1) & mask)
+	{
+		k = strshare_table[j]->hash & mask;
+		if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j)))
+		{
+			strshare_table[i] = strshare_table[j];
+			i = j;
+		}
+	}
+
+	strshare_table[i] = NULL;
+}
+
 void strshare_init(void)
 {
-	strshare_dict = mowgli_patricia_create(noopcanon);
+	strshare_resize(STRSHARE_MINSIZE);
 }
 
-stringref strshare_get(const char *str)
+/*
+ * strshare_get_len(const char *str, size_t len)
+ *
+ * Returns a shared copy of the first len bytes of str, which need not
+ * be terminated there; e.g. a word in a line being parsed.
+ */
+stringref strshare_get_len(const char *str, size_t len)
 {
 	strshare_t *ss;
+	unsigned int h, i;
 
 	if (str == NULL)
 		return NULL;
 
-	ss = mowgli_patricia_retrieve(strshare_dict, str);
-	if (ss != NULL)
-		ss->refcount++;
-	else
+	if (strshare_table == NULL)
+		strshare_init();
+
+	h = strshare_hash(str, len);
+
+	for (i = h & (strshare_size - 1); (ss = strshare_table[i]) != NULL; i = (i + 1) & (strshare_size - 1))
 	{
-		ss = smalloc(sizeof(strshare_t) + strlen(str) + 1);
-		ss->refcount = 1;
-		strcpy((char *)(ss + 1), str);
-		mowgli_patricia_add(strshare_dict, (char *)(ss + 1), ss);
+		if (ss->hash == h && ss->len == len && !memcmp(ss + 1, str, len))
+		{
+			ss->refcount++;
+			cnt.strshare_refs++;
+			return (char *)(ss + 1);
+		}
 	}
+
+	ss = smalloc(sizeof(strshare_t) + len + 1);
+	ss->refcount = 1;
+	ss->hash = h;
+	ss->len = len;
+	memcpy(ss + 1, str, len);
+	((char *)(ss + 1))[len] = '\0';
+
+	cnt.strshare++;
+	cnt.strshare_refs++;
+	cnt.strshare_bytes += len + 1;
+
+	if (cnt.strshare * 2 > strshare_size)
+		strshare_resize(strshare_size * 2);
+
+	strshare_insert(ss);
+
 	return (char *)(ss + 1);
 }
 
+stringref strshare_get(const char *str)
+{
+	if (str == NULL)
+		return NULL;
+
+	return strshare_get_len(str, strlen(str));
+}
+
 stringref strshare_ref(stringref str)
 {
 	strshare_t *ss;
@@ -65,6 +177,7 @@ stringref strshare_ref(stringref str)
 	/* intermediate cast to suppress gcc -Wcast-qual */
 	ss = (strshare_t *)(uintptr_t)str - 1;
 	ss->refcount++;
+	cnt.strshare_refs++;
 
 	return str;
 }
@@ -79,13 +192,28 @@ void strshare_unref(stringref str)
 	/* intermediate cast to suppress gcc -Wcast-qual */
 	ss = (strshare_t *)(uintptr_t)str - 1;
 	ss->refcount--;
+	cnt.strshare_refs--;
 	if (ss->refcount == 0)
 	{
-		mowgli_patricia_delete(strshare_dict, str);
+		strshare_remove(ss);
+		cnt.strshare--;
+		cnt.strshare_bytes -= ss->len + 1;
 		free(ss);
 	}
 }
 
+size_t strshare_len(stringref str)
+{
+	const strshare_t *ss;
+
+	if (str == NULL)
+		return 0;
+
+	ss = (const strshare_t *)(uintptr_t)str - 1;
+
+	return ss->len;
+}
+
 /* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
  * vim:ts=8
  * vim:sw=8
@@ -53,6 +53,7 @@ svsignore_t *svsignore_add(const char *mask, const char *reason)
         mowgli_node_add(svsignore, n, &svs_ignore_list);
 
         svsignore->mask = sstrdup(mask);
+        svsignore->matcher = hostmatch_create(mask);
         svsignore->settime = CURRTIME;
         svsignore->reason = sstrdup(reason);
         cnt.svsignore++;
@@ -79,23 +80,18 @@ svsignore_t *svsignore_find(user_t *source)
 {
         svsignore_t *svsignore;
         mowgli_node_t *n;
-        char host[BUFSIZE];
+        const char *host;
 
 	if (!use_svsignore)
 		return NULL;
 
-        *host = '\0';
-        mowgli_strlcpy(host, source->nick, BUFSIZE);
-        mowgli_strlcat(host, "!", BUFSIZE);
-        mowgli_strlcat(host, source->user, BUFSIZE);
-        mowgli_strlcat(host, "@", BUFSIZE);
-        mowgli_strlcat(host, source->host, BUFSIZE);
+        host = user_masks(source)->host;
 
         MOWGLI_ITER_FOREACH(n, svs_ignore_list.head)
         {
                 svsignore = (svsignore_t *)n->data;
 
-                if (!match(svsignore->mask, host))
+                if (!hostmatch(svsignore->matcher, host))
                         return svsignore;
         }
 
@@ -123,6 +119,7 @@ void svsignore_delete(svsignore_t *svsignore)
 	n = mowgli_node_find(svsignore, &svs_ignore_list);
 	mowgli_node_delete(n, &svs_ignore_list);
 
+	hostmatch_destroy(svsignore->matcher);
 	free(svsignore->mask);
 	free(svsignore->reason);
 	free(svsignore);
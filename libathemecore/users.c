@@ -278,6 +278,9 @@ void user_delete(user_t *u, const char *comment)
 	strshare_unref(u->chost);
 	strshare_unref(u->ip);
 
+	if (u->masks != NULL)
+		free(u->masks);
+
 	mowgli_heap_free(user_heap, u);
 
 	cnt.user--;
@@ -493,6 +496,7 @@ bool user_changenick(user_t *u, const char *nick, time_t ts)
 
 	strshare_unref(u->nick);
 	u->nick = strshare_get(nick);
+	user_mask_changed(u);
 
 	u->ts = ts;
 
@@ -616,11 +620,97 @@ void user_sethost(user_t *source, user_t *target, stringref host)
 
 	strshare_unref(target->vhost);
 	target->vhost = strshare_get(host);
+	user_mask_changed(target);
 
 	sethost_sts(source, target, target->vhost);
 	hook_call_user_sethost(target);
 }
 
+/*
+ * user_mask_changed(user_t *u)
+ *
+ * Tells the core that a user's nick, username, host, vhost, chost, IP
+ * address or gecos has changed.  Protocol modules that change these
+ * directly must call this afterwards.
+ *
+ * Inputs:
+ *     - user object whose mask changed
+ *
+ * Outputs:
+ *     - nothing
+ *
+ * Side Effects:
+ *     - the user's masks and cached channel access are recomputed on
+ *       next use
+ */
+void user_mask_changed(user_t *u)
+{
+	return_if_fail(u != NULL);
+
+	if (u->masks != NULL)
+	{
+		free(u->masks);
+		u->masks = NULL;
+	}
+
+	chanacs_cache_invalidate_user(u);
+}
+
+/*
+ * user_masks(user_t *u)
+ *
+ * Returns the nick!user@host masks of a user, for matching against bans,
+ * access entries and the like.
+ *
+ * Inputs:
+ *     - user object to get the masks of
+ *
+ * Outputs:
+ *     - the masks; they stay valid until user_mask_changed() is called
+ *
+ * Side Effects:
+ *     - the masks are built the first time they are asked for and kept
+ *       on the user after that
+ */
+const usermasks_t *user_masks(user_t *u)
+{
+	usermasks_t *m;
+	const char *ip, *gecos;
+	size_t prefixlen, len;
+	char *p;
+
+	return_val_if_fail(u != NULL, NULL);
+
+	if (u->masks != NULL)
+		return u->masks;
+
+	ip = u->ip != NULL ? u->ip : "";
+	gecos = u->gecos != NULL ? u->gecos : "";
+
+	/* nick!user@ for each of the five, plus hosts and terminators */
+	prefixlen = strlen(u->nick) + strlen(u->user) + 2;
+	len = 5 * (prefixlen + 1) + strlen(u->vhost) + strlen(u->chost) +
+		2 * strlen(u->host) + strlen(ip) + 1 + strlen(gecos);
+
+	m = smalloc(sizeof *m + len);
+	p = (char *)(m + 1);
+
+	m->vhost = p;
+	p += sprintf(p, "%s!%s@%s", u->nick, u->user, u->vhost) + 1;
+	m->chost = p;
+	p += sprintf(p, "%s!%s@%s", u->nick, u->user, u->chost) + 1;
+	m->host = p;
+	p += sprintf(p, "%s!%s@%s", u->nick, u->user, u->host) + 1;
+	m->ip = p;
+	p += sprintf(p, "%s!%s@%s", u->nick, u->user, ip) + 1;
+	m->gecos = p;
+	sprintf(p, "%s!%s@%s %s", u->nick, u->user, u->host, gecos);
+
+	u->masks = m;
+
+	return m;
+}
+
 const char *user_get_umodestr(user_t *u)
 {
 	static char result[34];
@@ -653,9 +743,9 @@ bool user_is_channel_banned(user_t *u, char ban_type)
 		if (cu->modes != 0)
 			continue;
 
-		if (next_matching_ban(cu->chan, u, ban_type, cu->chan->bans.head) != NULL)
+		if (next_matching_ban(cu->chan, u, ban_type, chanban_first(cu->chan, ban_type)) != NULL)
 		{
-			if (ircd->except_mchar == '\0' || next_matching_ban(cu->chan, u, ircd->except_mchar, cu->chan->bans.head) == NULL)
+			if (ircd->except_mchar == '\0' || next_matching_ban(cu->chan, u, ircd->except_mchar, chanban_first(cu->chan, ircd->except_mchar)) == NULL)
 				return true;
 			else
 				continue;
@@ -0,0 +1,764 @@
+/*
+ * Copyright (c) 2005-2012 Atheme Development Group
+ * Rights to this code are as documented in doc/LICENSE.
+ *
+ * This file contains a binary database backend for Atheme.  It stores the
+ * same rows as OpenSEX, but as length-prefixed rows of typed cells, and
+ * maps the whole file into memory on load so that the row handlers get
+ * pointers straight into the mapping instead of into a parse buffer.
+ *
+ * File layout (all integers are in host byte order):
+ *
+ *   header:  "ATHEMEDB" <u32 version> <u32 byte order mark>
+ *   row:     <u32 length> <u16 type id> <cell>*
+ *   cell:    <u8 tag> <payload>
+ *
+ * Type id 0 is reserved for type definitions, which are emitted the first
+ * time a row type is written: <u32 length> <u16 0> <u16 id> <name> NUL.
+ * Word and string cells are stored as <u32 length> <bytes> NUL, so that
+ * they can be handed out as C strings without copying.
+ */
+
+#include "atheme.h"
+
+#ifndef MOWGLI_OS_WIN
+# include <sys/mman.h>
+#endif
+
+DECLARE_MODULE_V1
+(
+	"backend/binary", true, _modinit, NULL,
+	PACKAGE_STRING,
+	VENDOR_STRING
+);
+
+#define BINARYDB_MAGIC		"ATHEMEDB"
+#define BINARYDB_MAGIC_LEN	8
+#define BINARYDB_VERSION	1
+#define BINARYDB_BOM		0x01020304U
+#define BINARYDB_HEADER_LEN	(BINARYDB_MAGIC_LEN + 2 * sizeof(uint32_t))
+#define BINARYDB_MAX_TYPES	65535
+
+#define BINARYDB_DEFAULT_FILE	"services.bdb"
+
+typedef enum {
+	BINARYDB_CELL_INT = 1,
+	BINARYDB_CELL_UINT,
+	BINARYDB_CELL_TIME,
+	BINARYDB_CELL_WORD,
+	BINARYDB_CELL_STR,
+} binarydb_cell_t;
+
+typedef struct binarydb_ {
+	/* Reading state */
+	char *map;
+	size_t maplen;
+	bool mapped;
+	size_t pos;
+	char *cell;
+	char *rowend;
+	const char **types;
+	unsigned int *dispatch;
+	unsigned int ntypes;
+	const char *type;
+	unsigned int typeid;
+	char numbuf[32];
+
+	/* Writing state */
+	FILE *f;
+	mowgli_patricia_t *typeids;
+	unsigned int nextid;
+	char *rowbuf;
+	size_t rowlen;
+	size_t rowsize;
+} binarydb_t;
+
+static void binarydb_corrupt(database_handle_t *db, const char *what)
+{
+	slog(LG_ERROR, "binarydb: %s at %s row %u token %u", what, db->file, db->line, db->token);
+	slog(LG_ERROR, "binarydb: exiting to avoid data loss");
+	exit(EXIT_FAILURE);
+}
+
+static void binarydb_db_parse(database_handle_t *db)
+{
+	binarydb_t *bs = (binarydb_t *)db->priv;
+	unsigned int *dispatch;
+
+	while (db_read_next_row(db))
+	{
+		/* row types are resolved to handlers once per file; a type
+		 * without a handler is looked up again, as a module loaded
+		 * by an earlier row may have registered one since.
+		 */
+		dispatch = &bs->dispatch[bs->typeid];
+		if (*dispatch == 0)
+			*dispatch = db_type_id(bs->type);
+
+		db_process_id(db, *dispatch, bs->type);
+	}
+}
+
+/***************************************************************************************************/
+
+static uint32_t binarydb_get_u32(const char *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof v);
+	return v;
+}
+
+static uint16_t binarydb_get_u16(const char *p)
+{
+	uint16_t v;
+
+	memcpy(&v, p, sizeof v);
+	return v;
+}
+
+static void binarydb_define_type(database_handle_t *db, char *p, char *end)
+{
+	binarydb_t *bs = (binarydb_t *)db->priv;
+	unsigned int id;
+
+	if (end - p < (ptrdiff_t)(sizeof(uint16_t) + 1) || end[-1] != '\0')
+		binarydb_corrupt(db, "malformed type definition");
+
+	id = binarydb_get_u16(p);
+	if (id == 0)
+		binarydb_corrupt(db, "type definition for reserved id 0");
+
+	if (id >= bs->ntypes)
+	{
+		bs->types = srealloc(bs->types, (id + 1) * sizeof(const char *));
+		memset(bs->types + bs->ntypes, 0, (id + 1 - bs->ntypes) * sizeof(const char *));
+		bs->dispatch = srealloc(bs->dispatch, (id + 1) * sizeof(unsigned int));
+		memset(bs->dispatch + bs->ntypes, 0, (id + 1 - bs->ntypes) * sizeof(unsigned int));
+		bs->ntypes = id + 1;
+	}
+
+	bs->types[id] = p + sizeof(uint16_t);
+	bs->dispatch[id] = 0;
+}
+
+static bool binarydb_read_next_row(database_handle_t *db)
+{
+	binarydb_t *bs = (binarydb_t *)db->priv;
+	uint32_t len;
+	unsigned int id;
+	char *row;
+
+	for (;;)
+	{
+		if (bs->pos == bs->maplen)
+			return false;
+
+		if (bs->maplen - bs->pos < sizeof(uint32_t) + sizeof(uint16_t))
+			binarydb_corrupt(db, "truncated row header");
+
+		len = binarydb_get_u32(bs->map + bs->pos);
+		row = bs->map + bs->pos + sizeof(uint32_t);
+
+		if (len < sizeof(uint16_t) || len > bs->maplen - bs->pos - sizeof(uint32_t))
+			binarydb_corrupt(db, "truncated row");
+
+		bs->pos += sizeof(uint32_t) + len;
+		bs->rowend = row + len;
+		db->line++;
+		db->token = 0;
+
+		id = binarydb_get_u16(row);
+		row += sizeof(uint16_t);
+
+		if (id == 0)
+		{
+			binarydb_define_type(db, row, bs->rowend);
+			continue;
+		}
+
+		if (id >= bs->ntypes || bs->types[id] == NULL)
+			binarydb_corrupt(db, "row of undefined type");
+
+		bs->type = bs->types[id];
+		bs->typeid = id;
+		bs->cell = row;
+		return true;
+	}
+}
+
+/* Returns the tag of the next cell and advances past the tag, or 0 at the
+ * end of the row.
+ */
+static unsigned int binarydb_next_tag(database_handle_t *db)
+{
+	binarydb_t *bs = (binarydb_t *)db->priv;
+	unsigned int tag;
+
+	if (bs->cell == NULL || bs->cell >= bs->rowend)
+		return 0;
+
+	tag = (unsigned char)*bs->cell++;
+	db->token++;
+
+	return tag;
+}
+
+static char *binarydb_read_string_cell(database_handle_t *db)
+{
+	binarydb_t *bs = (binarydb_t *)db->priv;
+	uint32_t len;
+	char *res;
+
+	if (bs->rowend - bs->cell < (ptrdiff_t)sizeof(uint32_t))
+		binarydb_corrupt(db, "truncated string cell");
+
+	len = binarydb_get_u32(bs->cell);
+	res = bs->cell + sizeof(uint32_t);
+
+	if ((size_t)(bs->rowend - res) < (size_t)len + 1 || res[len] != '\0')
+		binarydb_corrupt(db, "truncated string cell");
+
+	bs->cell = res + len + 1;
+	return res;
+}
+
+static bool binarydb_read_number_cell(database_handle_t *db, unsigned int tag, intmax_t *res)
+{
+	binarydb_t *bs = (binarydb_t *)db->priv;
+	size_t len;
+	int32_t i;
+	uint32_t u;
+	int64_t t;
+
+	len = tag == BINARYDB_CELL_TIME ? sizeof t : sizeof i;
+	if ((size_t)(bs->rowend - bs->cell) < len)
+		binarydb_corrupt(db, "truncated number cell");
+
+	switch (tag)
+	{
+		case BINARYDB_CELL_INT:
+			memcpy(&i, bs->cell, sizeof i);
+			*res = i;
+			break;
+		case BINARYDB_CELL_UINT:
+			memcpy(&u, bs->cell, sizeof u);
+			*res = u;
+			break;
+		case BINARYDB_CELL_TIME:
+			memcpy(&t, bs->cell, sizeof t);
+			*res = t;
+			break;
+		default:
+			return false;
+	}
+
+	bs->cell += len;
+	return true;
+}
+
+static const char *binarydb_read_word(database_handle_t *db)
+{
+	binarydb_t *bs = (binarydb_t *)db->priv;
+	unsigned int tag;
+	intmax_t num;
+
+	switch ((tag = binarydb_next_tag(db)))
+	{
+		case 0:
+			return NULL;
+		case BINARYDB_CELL_WORD:
+		case BINARYDB_CELL_STR:
+			return binarydb_read_string_cell(db);
+		case BINARYDB_CELL_INT:
+		case BINARYDB_CELL_UINT:
+		case BINARYDB_CELL_TIME:
+			/* handlers may read a number back as a word */
+			binarydb_read_number_cell(db, tag, &num);
+			snprintf(bs->numbuf, sizeof bs->numbuf, "%jd", num);
+			return bs->numbuf;
+		default:
+			binarydb_corrupt(db, "unknown cell type");
+			return NULL;
+	}
+}
+
+static const char *binarydb_read_str(database_handle_t *db)
+{
+	return binarydb_read_word(db);
+}
+
+static bool binarydb_read_number(database_handle_t *db, intmax_t *res)
+{
+	unsigned int tag;
+	const char *s;
+	char *rp;
+
+	switch ((tag = binarydb_next_tag(db)))
+	{
+		case 0:
+			return false;
+		case BINARYDB_CELL_INT:
+		case BINARYDB_CELL_UINT:
+		case BINARYDB_CELL_TIME:
+			return binarydb_read_number_cell(db, tag, res);
+		case BINARYDB_CELL_WORD:
+		case BINARYDB_CELL_STR:
+			/* rows converted from text may carry numbers as words */
+			s = binarydb_read_string_cell(db);
+			*res = strtoll(s, &rp, 0);
+			return *s && !*rp;
+		default:
+			binarydb_corrupt(db, "unknown cell type");
+			return false;
+	}
+}
+
+static bool binarydb_read_int(database_handle_t *db, int *res)
+{
+	intmax_t num;
+
+	if (!binarydb_read_number(db, &num))
+		return false;
+
+	*res = num;
+	return true;
+}
+
+static bool binarydb_read_uint(database_handle_t *db, unsigned int *res)
+{
+	intmax_t num;
+
+	if (!binarydb_read_number(db, &num))
+		return false;
+
+	*res = num;
+	return true;
+}
+
+static bool binarydb_read_time(database_handle_t *db, time_t *res)
+{
+	intmax_t num;
+
+	if (!binarydb_read_number(db, &num))
+		return false;
+
+	*res = num;
+	return true;
+}
+
+/***************************************************************************************************/
+
+static void binarydb_append(binarydb_t *bs, const void *data, size_t len)
+{
+	if (bs->rowlen + len > bs->rowsize)
+	{
+		while (bs->rowlen + len > bs->rowsize)
+			bs->rowsize *= 2;
+		bs->rowbuf = srealloc(bs->rowbuf, bs->rowsize);
+	}
+
+	memcpy(bs->rowbuf + bs->rowlen, data, len);
+	bs->rowlen += len;
+}
+
+static bool binarydb_flush_row(binarydb_t *bs)
+{
+	uint32_t len = bs->rowlen;
+
+	if (fwrite(&len, sizeof len, 1, bs->f) != 1)
+		return false;
+	if (fwrite(bs->rowbuf, bs->rowlen, 1, bs->f) != 1)
+		return false;
+
+	bs->rowlen = 0;
+	return true;
+}
+
+static bool binarydb_start_row(database_handle_t *db, const char *type)
+{
+	binarydb_t *bs;
+	uint16_t id;
+	uint16_t zero = 0;
+
+	return_val_if_fail(db != NULL, false);
+	return_val_if_fail(type != NULL, false);
+	bs = (binarydb_t *)db->priv;
+
+	id = (uintptr_t)mowgli_patricia_retrieve(bs->typeids, type);
+	if (id == 0)
+	{
+		if (bs->nextid > BINARYDB_MAX_TYPES)
+		{
+			slog(LG_ERROR, "binarydb: too many row types, cannot write %s", type);
+			return false;
+		}
+
+		id = bs->nextid++;
+		mowgli_patricia_add(bs->typeids, type, (void *)(uintptr_t)id);
+
+		bs->rowlen = 0;
+		binarydb_append(bs, &zero, sizeof zero);
+		binarydb_append(bs, &id, sizeof id);
+		binarydb_append(bs, type, strlen(type) + 1);
+		binarydb_flush_row(bs);
+	}
+
+	bs->rowlen = 0;
+	binarydb_append(bs, &id, sizeof id);
+
+	return true;
+}
+
+static bool binarydb_write_string(database_handle_t *db, binarydb_cell_t tag, const char *data)
+{
+	binarydb_t *bs;
+	unsigned char t = tag;
+	uint32_t len;
+
+	return_val_if_fail(db != NULL, false);
+	bs = (binarydb_t *)db->priv;
+
+	if (data == NULL)
+		data = "*";
+
+	len = strlen(data);
+	binarydb_append(bs, &t, sizeof t);
+	binarydb_append(bs, &len, sizeof len);
+	binarydb_append(bs, data, len + 1);
+
+	return true;
+}
+
+static bool binarydb_write_word(database_handle_t *db, const char *word)
+{
+	return binarydb_write_string(db, BINARYDB_CELL_WORD, word);
+}
+
+static bool binarydb_write_str(database_handle_t *db, const char *str)
+{
+	return binarydb_write_string(db, BINARYDB_CELL_STR, str);
+}
+
+static bool binarydb_write_int(database_handle_t *db, int num)
+{
+	binarydb_t *bs = (binarydb_t *)db->priv;
+	unsigned char t = BINARYDB_CELL_INT;
+	int32_t v = num;
+
+	binarydb_append(bs, &t, sizeof t);
+	binarydb_append(bs, &v, sizeof v);
+
+	return true;
+}
+
+static bool binarydb_write_uint(database_handle_t *db, unsigned int num)
+{
+	binarydb_t *bs = (binarydb_t *)db->priv;
+	unsigned char t = BINARYDB_CELL_UINT;
+	uint32_t v = num;
+
+	binarydb_append(bs, &t, sizeof t);
+	binarydb_append(bs, &v, sizeof v);
+
+	return true;
+}
+
+static bool binarydb_write_time(database_handle_t *db, time_t tm)
+{
+	binarydb_t *bs = (binarydb_t *)db->priv;
+	unsigned char t = BINARYDB_CELL_TIME;
+	int64_t v = tm;
+
+	binarydb_append(bs, &t, sizeof t);
+	binarydb_append(bs, &v, sizeof v);
+
+	return true;
+}
+
+static bool binarydb_commit_row(database_handle_t *db)
+{
+	binarydb_t *bs;
+
+	return_val_if_fail(db != NULL, false);
+	bs = (binarydb_t *)db->priv;
+
+	return binarydb_flush_row(bs);
+}
+
+static database_vtable_t binarydb_vt = {
+	.name = "binary",
+
+	.read_next_row = binarydb_read_next_row,
+
+	.read_word = binarydb_read_word,
+	.read_str = binarydb_read_str,
+	.read_int = binarydb_read_int,
+	.read_uint = binarydb_read_uint,
+	.read_time = binarydb_read_time,
+
+	.start_row = binarydb_start_row,
+	.write_word = binarydb_write_word,
+	.write_str = binarydb_write_str,
+	.write_int = binarydb_write_int,
+	.write_uint = binarydb_write_uint,
+	.write_time = binarydb_write_time,
+	.commit_row = binarydb_commit_row
+};
+
+/* Maps the file into memory.  The mapping is private and writable, as some
+ * handlers modify the strings they are given in place; those writes never
+ * reach the file.  Falls back to reading the file into a buffer.
+ */
+static bool binarydb_map(binarydb_t *bs, int fd, size_t len)
+{
+	size_t n = 0;
+	ssize_t r;
+
+	bs->maplen = len;
+	if (len == 0)
+		return true;
+
+#ifndef MOWGLI_OS_WIN
+	bs->map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (bs->map != MAP_FAILED)
+	{
+# ifdef MADV_SEQUENTIAL
+		madvise(bs->map, len, MADV_SEQUENTIAL);
+# endif
+		bs->mapped = true;
+		return true;
+	}
+
+	slog(LG_DEBUG, "binarydb: mmap failed (%s), reading file into memory", strerror(errno));
+#endif
+
+	bs->map = smalloc(len);
+	while (n < len)
+	{
+		if ((r = read(fd, bs->map + n, len - n)) <= 0)
+		{
+			free(bs->map);
+			bs->map = NULL;
+			return false;
+		}
+		n += r;
+	}
+
+	return true;
+}
+
+static void binarydb_unmap(binarydb_t *bs)
+{
+	if (bs->map == NULL)
+		return;
+
+#ifndef MOWGLI_OS_WIN
+	if (bs->mapped)
+	{
+		munmap(bs->map, bs->maplen);
+		return;
+	}
+#endif
+
+	free(bs->map);
+}
+
+static database_handle_t *binarydb_db_open_read(const char *filename)
+{
+	database_handle_t *db;
+	binarydb_t *bs;
+	struct stat st;
+	int fd;
+	int errno1;
+	char path[BUFSIZE];
+
+	snprintf(path, BUFSIZE, "%s/%s", datadir, filename != NULL ? filename : BINARYDB_DEFAULT_FILE);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		errno1 = errno;
+
+		/* ENOENT can happen if the database does not exist yet. */
+		if (errno == ENOENT)
+		{
+			slog(LG_ERROR, "db-open-read: database '%s' does not yet exist; a new one will be created.", path);
+			return NULL;
+		}
+
+		slog(LG_ERROR, "db-open-read: cannot open '%s' for reading: %s", path, strerror(errno1));
+		wallops(_("\2DATABASE ERROR\2: db-open-read: cannot open '%s' for reading: %s"), path, strerror(errno1));
+		return NULL;
+	}
+
+	bs = scalloc(sizeof(binarydb_t), 1);
+
+	if (fstat(fd, &st) < 0 || !binarydb_map(bs, fd, st.st_size))
+	{
+		errno1 = errno;
+		slog(LG_ERROR, "db-open-read: cannot read '%s': %s", path, strerror(errno1));
+		wallops(_("\2DATABASE ERROR\2: db-open-read: cannot read '%s': %s"), path, strerror(errno1));
+		close(fd);
+		free(bs);
+		return NULL;
+	}
+
+	close(fd);
+
+	if (bs->maplen < BINARYDB_HEADER_LEN || memcmp(bs->map, BINARYDB_MAGIC, BINARYDB_MAGIC_LEN))
+	{
+		slog(LG_ERROR, "db-open-read: '%s' is not a binary database", path);
+		slog(LG_ERROR, "db-open-read: exiting to avoid data loss");
+		exit(EXIT_FAILURE);
+	}
+
+	if (binarydb_get_u32(bs->map + BINARYDB_MAGIC_LEN) != BINARYDB_VERSION ||
+	    binarydb_get_u32(bs->map + BINARYDB_MAGIC_LEN + sizeof(uint32_t)) != BINARYDB_BOM)
+	{
+		slog(LG_ERROR, "db-open-read: '%s' was written by an incompatible version or on a host with a different byte order", path);
+		slog(LG_ERROR, "db-open-read: exiting to avoid data loss");
+		exit(EXIT_FAILURE);
+	}
+
+	bs->pos = BINARYDB_HEADER_LEN;
+
+	db = scalloc(sizeof(database_handle_t), 1);
+	db->priv = bs;
+	db->vt = &binarydb_vt;
+	db->txn = DB_READ;
+	db->file = sstrdup(path);
+	db->line = 0;
+	db->token = 0;
+
+	return db;
+}
+
+static database_handle_t *binarydb_db_open_write(const char *filename)
+{
+	database_handle_t *db;
+	binarydb_t *bs;
+	int fd;
+	FILE *f;
+	int errno1;
+	uint32_t hdr[2] = { BINARYDB_VERSION, BINARYDB_BOM };
+	char bpath[BUFSIZE], path[BUFSIZE];
+
+	snprintf(bpath, BUFSIZE, "%s/%s", datadir, filename != NULL ? filename : BINARYDB_DEFAULT_FILE);
+
+	mowgli_strlcpy(path, bpath, sizeof path);
+	mowgli_strlcat(path, ".new", sizeof path);
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+	if (fd < 0 || ! (f = fdopen(fd, "wb")))
+	{
+		errno1 = errno;
+		slog(LG_ERROR, "db-open-write: cannot open '%s' for writing: %s", path, strerror(errno1));
+		wallops(_("\2DATABASE ERROR\2: db-open-write: cannot open '%s' for writing: %s"), path, strerror(errno1));
+		return NULL;
+	}
+
+	fwrite(BINARYDB_MAGIC, BINARYDB_MAGIC_LEN, 1, f);
+	fwrite(hdr, sizeof hdr, 1, f);
+
+	bs = scalloc(sizeof(binarydb_t), 1);
+	bs->f = f;
+	bs->typeids = mowgli_patricia_create(NULL);
+	bs->nextid = 1;
+	bs->rowsize = 512;
+	bs->rowbuf = smalloc(bs->rowsize);
+
+	db = scalloc(sizeof(database_handle_t), 1);
+	db->priv = bs;
+	db->vt = &binarydb_vt;
+	db->txn = DB_WRITE;
+	db->file = sstrdup(bpath);
+	db->line = 0;
+	db->token = 0;
+
+	return db;
+}
+
+static database_handle_t *binarydb_db_open(const char *filename, database_transaction_t txn)
+{
+	if (txn == DB_WRITE)
+		return binarydb_db_open_write(filename);
+	return binarydb_db_open_read(filename);
+}
+
+static bool binarydb_db_close(database_handle_t *db)
+{
+	binarydb_t *bs;
+	int errno1;
+	bool ret = true;
+	char oldpath[BUFSIZE], newpath[BUFSIZE];
+
+	return_val_if_fail(db != NULL, false);
+	bs = db->priv;
+
+	if (db->txn == DB_WRITE)
+	{
+		mowgli_strlcpy(oldpath, db->file, sizeof oldpath);
+		mowgli_strlcat(oldpath, ".new", sizeof oldpath);
+
+		mowgli_strlcpy(newpath, db->file, sizeof newpath);
+
+		if (ferror(bs->f) || fflush(bs->f) == EOF)
+		{
+			errno1 = errno;
+			slog(LG_ERROR, "db_save(): cannot write to %s: %s", oldpath, strerror(errno1));
+			wallops(_("\2DATABASE ERROR\2: db_save(): cannot write to %s: %s"), oldpath, strerror(errno1));
+			ret = false;
+		}
+
+		fclose(bs->f);
+
+		/* now, replace the old database with the new one, using an atomic rename,
+		 * but only if the new one was written out completely.
+		 */
+		if (ret && srename(oldpath, newpath) < 0)
+		{
+			errno1 = errno;
+			slog(LG_ERROR, "db_save(): cannot rename %s to %s: %s", oldpath, newpath, strerror(errno1));
+			wallops(_("\2DATABASE ERROR\2: db_save(): cannot rename %s to %s: %s"), oldpath, newpath, strerror(errno1));
+			ret = false;
+		}
+
+		mowgli_patricia_destroy(bs->typeids, NULL, NULL);
+		free(bs->rowbuf);
+	}
+	else
+	{
+		binarydb_unmap(bs);
+		free(bs->types);
+		free(bs->dispatch);
+	}
+
+	free(bs);
+	free(db->file);
+	free(db);
+
+	return ret;
+}
+
+static database_module_t binarydb_mod = {
+	.db_open = binarydb_db_open,
+	.db_close = binarydb_db_close,
+	.db_parse = binarydb_db_parse,
+};
+
+void _modinit(module_t *m)
+{
+	MODULE_TRY_REQUEST_DEPENDENCY(m, "backend/corestorage");
+
+	m->mflags = MODTYPE_CORE;
+
+	db_mod = &binarydb_mod;
+
+	backend_loaded = true;
+}
+
+/* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
+ * vim:ts=8
+ * vim:sw=8
+ * vim:noexpandtab
+ */
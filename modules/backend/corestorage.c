@@ -17,6 +17,11 @@
  */
 
 #include "atheme.h"
+#include "conf.h"
+
+#ifdef HAVE_FORK
+# include <sys/wait.h>
+#endif
 
 DECLARE_MODULE_V1
 (
@@ -28,6 +33,10 @@ DECLARE_MODULE_V1
 unsigned int dbv;
 unsigned int their_ca_all;
 
+/* database::snapshot: write the database from a forked child process */
+static bool db_snapshot = false;
+static pid_t db_snapshot_pid = 0;
+
 extern mowgli_list_t modules;
 
 /* write atheme.db (core fields) */
@@ -35,6 +44,7 @@ static void
 corestorage_db_save(database_handle_t *db)
 {
 	metadata_t *md;
+	unsigned int mdi;
 	myuser_t *mu;
 	myentity_t *ment;
 	myuser_name_t *mun;
@@ -60,6 +70,12 @@ corestorage_db_save(database_handle_t *db)
 	{
 		module_t *m = n->data;
 
+		/* the backend is chosen by the configuration, not the data;
+		 * do not make tools like dbverify load it from here.
+		 */
+		if (!strncmp(m->name, "backend/", 8))
+			continue;
+
 		db_start_row(db, "MDEP");
 		db_write_word(db, m->name);
 		db_commit_row(db);
@@ -95,10 +111,37 @@ corestorage_db_save(database_handle_t *db)
 		db_write_word(db, language_get_name(mu->language));
 		db_commit_row(db);
 
+		/* metadata that expiry looks at stays out of the cold data,
+		 * see myuser_metadata_is_hot().
+		 */
+		if (object(mu)->metadata)
+		{
+			METADATA_FOREACH(md, mdi, mu)
+			{
+				if (!myuser_metadata_is_hot(md->name))
+					continue;
+
+				db_start_row(db, "MDU");
+				db_write_word(db, entity(mu)->name);
+				db_write_word(db, md->name);
+				db_write_str(db, md->value);
+				db_commit_row(db);
+			}
+		}
+
+		/* if the cold data of the account has not been loaded, it is
+		 * all still in the database and the backend copies it over.
+		 */
+		if (!db_start_cold(db, mu))
+			myuser_load_cold(mu);
+
 		if (object(mu)->metadata)
 		{
-			MOWGLI_PATRICIA_FOREACH(md, &state, object(mu)->metadata)
+			METADATA_FOREACH(md, mdi, mu)
 			{
+				if (myuser_metadata_is_hot(md->name))
+					continue;
+
 				db_start_row(db, "MDU");
 				db_write_word(db, entity(mu)->name);
 				db_write_word(db, md->name);
@@ -136,6 +179,8 @@ corestorage_db_save(database_handle_t *db)
 			db_commit_row(db);
 		}
 
+		db_end_cold(db);
+
 		MOWGLI_ITER_FOREACH(tn, mu->nicks.head)
 		{
 			mynick_t *mn = tn->data;
@@ -166,8 +211,6 @@ corestorage_db_save(database_handle_t *db)
 
 	MOWGLI_PATRICIA_FOREACH(mc, &state, mclist)
 	{
-		mowgli_patricia_iteration_state_t state2;
-
 		char *flags = gflags_tostr(mc_flags, mc->flags);
 		/* find a founder */
 		mu = NULL;
@@ -206,7 +249,7 @@ corestorage_db_save(database_handle_t *db)
 
 			if (object(ca)->metadata)
 			{
-				MOWGLI_PATRICIA_FOREACH(md, &state2, object(ca)->metadata)
+				METADATA_FOREACH(md, mdi, ca)
 				{
 					db_start_row(db, "MDA");
 					db_write_word(db, ca->mychan->name);
@@ -220,7 +263,7 @@ corestorage_db_save(database_handle_t *db)
 
 		if (object(mc)->metadata)
 		{
-			MOWGLI_PATRICIA_FOREACH(md, &state2, object(mc)->metadata)
+			METADATA_FOREACH(md, mdi, mc)
 			{
 				db_start_row(db, "MDC");
 				db_write_word(db, mc->name);
@@ -234,15 +277,13 @@ corestorage_db_save(database_handle_t *db)
 	/* Old names */
 	MOWGLI_PATRICIA_FOREACH(mun, &state, oldnameslist)
 	{
-		mowgli_patricia_iteration_state_t state2;
-
 		db_start_row(db, "NAM");
 		db_write_word(db, mun->name);
 		db_commit_row(db);
 
 		if (object(mun)->metadata)
 		{
-			MOWGLI_PATRICIA_FOREACH(md, &state2, object(mun)->metadata)
+			METADATA_FOREACH(md, mdi, mun)
 			{
 				db_start_row(db, "MDN");
 				db_write_word(db, mun->name);
@@ -925,16 +966,124 @@ static void corestorage_db_load(const char *filename)
 	db_close(db);
 }
 
-static void corestorage_db_write(void *filename)
+static bool corestorage_db_write_sync(const char *filename)
 {
 	database_handle_t *db;
 
 	db = db_open(filename, DB_WRITE);
+	if (db == NULL)
+		return false;
 
 	corestorage_db_save(db);
 	hook_call_db_write(db);
 
-	db_close(db);
+	return db_close(db);
+}
+
+#ifdef HAVE_FORK
+static void corestorage_snapshot_done(pid_t pid, int status, void *data)
+{
+	db_snapshot_pid = 0;
+
+	if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS)
+	{
+		slog(LG_DEBUG, "db_save(): snapshot process %d finished", (int)pid);
+		hook_call_db_saved();
+		return;
+	}
+
+	if (WIFSIGNALED(status))
+	{
+		slog(LG_ERROR, "db_save(): snapshot process %d died with signal %d", (int)pid, WTERMSIG(status));
+		wallops(_("\2DATABASE ERROR\2: db_save(): snapshot process died with signal %d"), WTERMSIG(status));
+	}
+	else
+	{
+		slog(LG_ERROR, "db_save(): snapshot process %d exited with status %d", (int)pid, WEXITSTATUS(status));
+		wallops(_("\2DATABASE ERROR\2: db_save(): snapshot process exited with status %d"), WEXITSTATUS(status));
+	}
+}
+
+/* waits for a snapshot in progress to finish, so that a synchronous save
+ * does not race it for services.db.new.
+ */
+static void corestorage_snapshot_wait(void)
+{
+	int status;
+
+	if (db_snapshot_pid == 0)
+		return;
+
+	slog(LG_INFO, "db_save(): waiting for snapshot process %d to finish", (int)db_snapshot_pid);
+
+	if (waitpid(db_snapshot_pid, &status, 0) == db_snapshot_pid)
+	{
+		childproc_delete_all(corestorage_snapshot_done);
+		corestorage_snapshot_done(db_snapshot_pid, status, NULL);
+	}
+	else
+	{
+		childproc_delete_all(corestorage_snapshot_done);
+		db_snapshot_pid = 0;
+	}
+}
+
+static bool corestorage_snapshot_start(const char *filename)
+{
+	pid_t pid;
+
+	if (db_snapshot_pid != 0)
+	{
+		slog(LG_INFO, "db_save(): snapshot process %d is still running; not starting another", (int)db_snapshot_pid);
+		return true;
+	}
+
+	hook_call_db_save_start();
+
+	switch (pid = fork())
+	{
+		case -1:
+			slog(LG_ERROR, "db_save(): cannot fork snapshot process: %s; saving in the foreground", strerror(errno));
+			return false;
+		case 0:
+			/* the child works on a frozen copy of everything; it must
+			 * not touch the uplink or any other connection.
+			 */
+			connection_close_all_fds();
+			_exit(corestorage_db_write_sync(filename) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	db_snapshot_pid = pid;
+	childproc_add(pid, "db_save", corestorage_snapshot_done, NULL);
+	slog(LG_DEBUG, "db_save(): started snapshot process %d", (int)pid);
+
+	return true;
+}
+#endif
+
+static void corestorage_db_write(void *filename)
+{
+#ifdef HAVE_FORK
+	if (db_snapshot && !(runflags & (RF_STARTING | RF_SHUTDOWN | RF_RESTART)))
+	{
+		/* the snapshot has already called db_save_start, even if it
+		 * could not fork and the save continues in the foreground.
+		 */
+		if (!corestorage_snapshot_start(filename))
+		{
+			if (corestorage_db_write_sync(filename))
+				hook_call_db_saved();
+		}
+		return;
+	}
+
+	corestorage_snapshot_wait();
+#endif
+
+	hook_call_db_save_start();
+
+	if (corestorage_db_write_sync(filename))
+		hook_call_db_saved();
 }
 
 void _modinit(module_t *m)
@@ -944,6 +1093,8 @@ void _modinit(module_t *m)
 	db_load = &corestorage_db_load;
 	db_save = &corestorage_db_write;
 
+	add_bool_conf_item("SNAPSHOT", &conf_db_table, 0, &db_snapshot, false);
+
 	db_register_type_handler("DBV", corestorage_h_dbv);
 	db_register_type_handler("MDEP", corestorage_ignore_row);
 	db_register_type_handler("LUID", corestorage_h_luid);
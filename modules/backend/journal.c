@@ -0,0 +1,1168 @@
+/*
+ * Copyright (c) 2005-2012 Atheme Development Group
+ * Rights to this code are as documented in doc/LICENSE.
+ *
+ * This file contains an append-only change journal which sits between full
+ * database writes.  Changes to accounts, nicks, channels, access entries,
+ * metadata and K-lines are appended to services.journal as they happen,
+ * and replayed on top of the last full database on startup, so that
+ * commit_interval can be long without risking the loss of recent changes.
+ *
+ * When a database write starts, the journal is moved aside to
+ * services.journal.old and a new one is started; the old one is removed
+ * once the write has completed.
+ *
+ * JMU and JMC rows record all of an account or channel, and replaying one
+ * overwrites whatever the database has, including fields changed since
+ * without being journaled.  New accounts and channels are therefore only
+ * journaled once the command creating them has filled them in, see
+ * journal_defer_new().
+ *
+ * Only changes made through the core functions are journaled; fields which
+ * modules change directly (account and channel flags, memos, groups, ...)
+ * are written by the next full database write as before.
+ */
+
+#include "atheme.h"
+#include "conf.h"
+
+DECLARE_MODULE_V1
+(
+	"backend/journal", true, _modinit, NULL,
+	PACKAGE_STRING,
+	VENDOR_STRING
+);
+
+#define JOURNAL_FILE		"services.journal"
+#define JOURNAL_FILE_OLD	"services.journal.old"
+
+typedef struct journal_ {
+	/* Reading state */
+	FILE *f;
+	char *buf;
+	unsigned int bufsize;
+	char *token;
+
+	/* Writing state */
+	int fd;
+	char *wbuf;
+	size_t wlen;
+	size_t wsize;
+} journal_t;
+
+/* database::journal_sync: seconds between fsyncs of the journal, 0 for
+ * an fsync after every change.
+ */
+static unsigned int journal_sync_interval = 1;
+
+static database_handle_t *journal_db = NULL;
+static mowgli_eventloop_timer_t *journal_timer = NULL;
+static bool journal_dirty = false;
+static bool journal_pending = false;
+
+static void (*journal_db_load_next)(const char *arg) = NULL;
+
+static void journal_path(char *buf, size_t size, const char *file)
+{
+	snprintf(buf, size, "%s/%s", datadir, file);
+}
+
+/***************************************************************************************************/
+
+static bool journal_read_next_row(database_handle_t *db)
+{
+	int c = 0;
+	unsigned int n = 0;
+	journal_t *js = (journal_t *)db->priv;
+
+	while ((c = getc(js->f)) != EOF && c != '\n')
+	{
+		js->buf[n++] = c;
+		if (n == js->bufsize)
+		{
+			js->bufsize *= 2;
+			js->buf = srealloc(js->buf, js->bufsize);
+		}
+	}
+	js->buf[n] = '\0';
+	js->token = js->buf;
+
+	if (c == EOF && ferror(js->f))
+	{
+		slog(LG_ERROR, "journal-read-next-row: error at %s line %d: %s", db->file, db->line, strerror(errno));
+		slog(LG_ERROR, "journal-read-next-row: exiting to avoid data loss");
+		exit(EXIT_FAILURE);
+	}
+
+	/* a row without a newline at the end is a torn write from a crash */
+	if (c == EOF)
+	{
+		if (n != 0)
+			slog(LG_INFO, "journal: ignoring incomplete row at %s line %d", db->file, db->line + 1);
+		return false;
+	}
+
+	db->line++;
+	db->token = 0;
+	return true;
+}
+
+static const char *journal_read_word(database_handle_t *db)
+{
+	journal_t *js = (journal_t *)db->priv;
+	char *ptr;
+	char *res;
+
+	res = js->token;
+	if (res == NULL)
+		return NULL;
+
+	ptr = strchr(res, ' ');
+	if (ptr != NULL)
+	{
+		*ptr++ = '\0';
+		js->token = ptr;
+	}
+	else
+		js->token = NULL;
+
+	db->token++;
+
+	return res;
+}
+
+static const char *journal_read_str(database_handle_t *db)
+{
+	journal_t *js = (journal_t *)db->priv;
+	char *res;
+
+	res = js->token;
+	js->token = NULL;
+
+	db->token++;
+	return res;
+}
+
+static bool journal_read_int(database_handle_t *db, int *res)
+{
+	const char *s = db_read_word(db);
+	char *rp;
+
+	if (!s) return false;
+
+	*res = strtol(s, &rp, 0);
+	return *s && !*rp;
+}
+
+static bool journal_read_uint(database_handle_t *db, unsigned int *res)
+{
+	const char *s = db_read_word(db);
+	char *rp;
+
+	if (!s) return false;
+
+	*res = strtoul(s, &rp, 0);
+	return *s && !*rp;
+}
+
+static bool journal_read_time(database_handle_t *db, time_t *res)
+{
+	const char *s = db_read_word(db);
+	char *rp;
+
+	if (!s) return false;
+
+	*res = strtoul(s, &rp, 0);
+	return *s && !*rp;
+}
+
+static void journal_append(journal_t *js, const char *data, size_t len)
+{
+	if (js->wlen + len > js->wsize)
+	{
+		while (js->wlen + len > js->wsize)
+			js->wsize *= 2;
+		js->wbuf = srealloc(js->wbuf, js->wsize);
+	}
+
+	memcpy(js->wbuf + js->wlen, data, len);
+	js->wlen += len;
+}
+
+static bool journal_start_row(database_handle_t *db, const char *type)
+{
+	journal_t *js;
+
+	return_val_if_fail(db != NULL, false);
+	return_val_if_fail(type != NULL, false);
+	js = (journal_t *)db->priv;
+
+	js->wlen = 0;
+	journal_append(js, type, strlen(type));
+
+	return true;
+}
+
+static bool journal_write_cell(database_handle_t *db, const char *data)
+{
+	journal_t *js;
+
+	return_val_if_fail(db != NULL, false);
+	js = (journal_t *)db->priv;
+
+	if (data == NULL)
+		data = "*";
+
+	journal_append(js, " ", 1);
+	journal_append(js, data, strlen(data));
+
+	return true;
+}
+
+static bool journal_write_int(database_handle_t *db, int num)
+{
+	char buf[32];
+	snprintf(buf, sizeof buf, "%d", num);
+	return journal_write_cell(db, buf);
+}
+
+static bool journal_write_uint(database_handle_t *db, unsigned int num)
+{
+	char buf[32];
+	snprintf(buf, sizeof buf, "%u", num);
+	return journal_write_cell(db, buf);
+}
+
+static bool journal_write_time(database_handle_t *db, time_t tm)
+{
+	char buf[32];
+	snprintf(buf, sizeof buf, "%lu", (unsigned long)tm);
+	return journal_write_cell(db, buf);
+}
+
+static void journal_sync(void *arg)
+{
+	journal_t *js;
+
+	if (journal_db == NULL || !journal_dirty)
+		return;
+
+	js = (journal_t *)journal_db->priv;
+
+	if (fsync(js->fd) < 0)
+		slog(LG_ERROR, "journal: cannot sync %s: %s", journal_db->file, strerror(errno));
+
+	journal_dirty = false;
+}
+
+/* Rows are written out as soon as they are committed, so that they survive
+ * a crash of services; the fsync which makes them survive a crash of the
+ * host is done for all rows committed within journal_sync seconds at once.
+ */
+static bool journal_commit_row(database_handle_t *db)
+{
+	journal_t *js;
+	size_t off = 0;
+	ssize_t n;
+
+	return_val_if_fail(db != NULL, false);
+	js = (journal_t *)db->priv;
+
+	journal_append(js, "\n", 1);
+
+	while (off < js->wlen)
+	{
+		if ((n = write(js->fd, js->wbuf + off, js->wlen - off)) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			slog(LG_ERROR, "journal: cannot write to %s: %s", db->file, strerror(errno));
+			wallops(_("\2DATABASE ERROR\2: journal: cannot write to %s: %s"), db->file, strerror(errno));
+			js->wlen = 0;
+			return false;
+		}
+
+		off += n;
+	}
+
+	js->wlen = 0;
+	journal_dirty = true;
+
+	if (journal_sync_interval == 0)
+		journal_sync(NULL);
+
+	return true;
+}
+
+static database_vtable_t journal_vt = {
+	.name = "journal",
+
+	.read_next_row = journal_read_next_row,
+
+	.read_word = journal_read_word,
+	.read_str = journal_read_str,
+	.read_int = journal_read_int,
+	.read_uint = journal_read_uint,
+	.read_time = journal_read_time,
+
+	.start_row = journal_start_row,
+	.write_word = journal_write_cell,
+	.write_str = journal_write_cell,
+	.write_int = journal_write_int,
+	.write_uint = journal_write_uint,
+	.write_time = journal_write_time,
+	.commit_row = journal_commit_row
+};
+
+/***************************************************************************************************/
+
+static database_handle_t *journal_open_write(void)
+{
+	database_handle_t *db;
+	journal_t *js;
+	int fd;
+	char path[BUFSIZE];
+
+	journal_path(path, sizeof path, JOURNAL_FILE);
+
+	fd = open(path, O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+	if (fd < 0)
+	{
+		slog(LG_ERROR, "journal: cannot open '%s' for writing: %s", path, strerror(errno));
+		wallops(_("\2DATABASE ERROR\2: journal: cannot open '%s' for writing: %s"), path, strerror(errno));
+		return NULL;
+	}
+
+	js = scalloc(sizeof(journal_t), 1);
+	js->fd = fd;
+	js->wsize = 512;
+	js->wbuf = smalloc(js->wsize);
+
+	db = scalloc(sizeof(database_handle_t), 1);
+	db->priv = js;
+	db->vt = &journal_vt;
+	db->txn = DB_WRITE;
+	db->file = sstrdup(path);
+
+	return db;
+}
+
+static void journal_close_write(database_handle_t *db)
+{
+	journal_t *js = (journal_t *)db->priv;
+
+	journal_sync(NULL);
+
+	close(js->fd);
+	free(js->wbuf);
+	free(js);
+	free(db->file);
+	free(db);
+}
+
+static void journal_replay(const char *file)
+{
+	database_handle_t *db;
+	journal_t *js;
+	FILE *f;
+	const char *type;
+	char path[BUFSIZE];
+
+	journal_path(path, sizeof path, file);
+
+	if ((f = fopen(path, "r")) == NULL)
+	{
+		if (errno != ENOENT)
+		{
+			slog(LG_ERROR, "journal: cannot open '%s' for reading: %s", path, strerror(errno));
+			slog(LG_ERROR, "journal: exiting to avoid data loss");
+			exit(EXIT_FAILURE);
+		}
+
+		return;
+	}
+
+	js = scalloc(sizeof(journal_t), 1);
+	js->f = f;
+	js->bufsize = 512;
+	js->buf = smalloc(js->bufsize);
+
+	db = scalloc(sizeof(database_handle_t), 1);
+	db->priv = js;
+	db->vt = &journal_vt;
+	db->txn = DB_READ;
+	db->file = sstrdup(path);
+
+	while (db_read_next_row(db))
+	{
+		type = db_read_word(db);
+		if (!type || !*type)
+			continue;
+		db_process(db, type);
+	}
+
+	slog(LG_INFO, "journal: replayed %u changes from %s", db->line, path);
+	db_log_stats(db);
+
+	fclose(f);
+	free(js->buf);
+	free(js);
+	free(db->file);
+	free(db);
+}
+
+static void journal_db_load(const char *arg)
+{
+	char path[BUFSIZE];
+	struct stat st;
+
+	if (journal_db_load_next != NULL)
+		journal_db_load_next(arg);
+
+	/* services.journal.old is only left behind if the last database
+	 * write did not complete, so it goes before services.journal.
+	 */
+	journal_path(path, sizeof path, JOURNAL_FILE_OLD);
+	journal_pending = stat(path, &st) == 0;
+
+	journal_replay(JOURNAL_FILE_OLD);
+	journal_replay(JOURNAL_FILE);
+
+	if (!readonly)
+		journal_db = journal_open_write();
+}
+
+/***************************************************************************************************/
+
+static bool journal_active(void)
+{
+	return journal_db != NULL && !(runflags & RF_STARTING) && !myuser_cold_loading;
+}
+
+/* Accounts and channels are created half-initialised: the command that
+ * registers them sets lastlogin, MU_WAITAUTH, used, the mlock and so on
+ * afterwards.  They are kept here instead of being journaled right away,
+ * and journaled whole, with their nicks, access entries and metadata, by
+ * journal_flush_new() once the event loop comes back around.
+ */
+static mowgli_list_t journal_new_myusers;
+static mowgli_list_t journal_new_mychans;
+static mowgli_eventloop_timer_t *journal_new_timer = NULL;
+
+static bool journal_myuser_is_new(myuser_t *mu)
+{
+	return mowgli_node_find(mu, &journal_new_myusers) != NULL;
+}
+
+static bool journal_mychan_is_new(mychan_t *mc)
+{
+	return mowgli_node_find(mc, &journal_new_mychans) != NULL;
+}
+
+static void journal_forget_new(void *obj, mowgli_list_t *list)
+{
+	mowgli_node_t *n;
+
+	if ((n = mowgli_node_find(obj, list)) != NULL)
+	{
+		mowgli_node_delete(n, list);
+		mowgli_node_free(n);
+	}
+}
+
+static void journal_write_myuser(myuser_t *mu)
+{
+	database_handle_t *db = journal_db;
+	const char *flags;
+
+	flags = gflags_tostr(mu_flags, MOWGLI_LIST_LENGTH(&mu->logins) ? mu->flags & ~MU_NOBURSTLOGIN : mu->flags);
+
+	/* JMU <uid> <name> <pass> <email> <registered> <lastlogin> <flags> <language> */
+	db_start_row(db, "JMU");
+	db_write_word(db, entity(mu)->id);
+	db_write_word(db, entity(mu)->name);
+	db_write_word(db, mu->pass);
+	db_write_word(db, mu->email);
+	db_write_time(db, mu->registered);
+	db_write_time(db, mu->lastlogin);
+	db_write_word(db, flags);
+	db_write_word(db, language_get_name(mu->language));
+	db_commit_row(db);
+}
+
+static void journal_write_mynick(mynick_t *mn)
+{
+	/* JMN <account> <nick> <registered> <lastseen> */
+	db_start_row(journal_db, "JMN");
+	db_write_word(journal_db, entity(mn->owner)->name);
+	db_write_word(journal_db, mn->nick);
+	db_write_time(journal_db, mn->registered);
+	db_write_time(journal_db, mn->lastseen);
+	db_commit_row(journal_db);
+}
+
+static void journal_write_mychan(mychan_t *mc)
+{
+	database_handle_t *db = journal_db;
+
+	/* JMC <name> <registered> <used> <flags> <mlock_on> <mlock_off> <mlock_limit> [mlock_key] */
+	db_start_row(db, "JMC");
+	db_write_word(db, mc->name);
+	db_write_time(db, mc->registered);
+	db_write_time(db, mc->used);
+	db_write_word(db, gflags_tostr(mc_flags, mc->flags));
+	db_write_uint(db, mc->mlock_on);
+	db_write_uint(db, mc->mlock_off);
+	db_write_uint(db, mc->mlock_limit);
+	db_write_word(db, mc->mlock_key ? mc->mlock_key : "");
+	db_commit_row(db);
+}
+
+static void journal_write_chanacs(chanacs_t *ca)
+{
+	database_handle_t *db = journal_db;
+
+	/* JCA <channel> <target> <flags> <modified> <setter> */
+	db_start_row(db, "JCA");
+	db_write_word(db, ca->mychan->name);
+	db_write_word(db, ca->entity ? ca->entity->name : ca->host);
+	db_write_word(db, bitmask_to_flags(ca->level));
+	db_write_time(db, ca->tmodified);
+	db_write_word(db, ca->setter ? ca->setter : "*");
+	db_commit_row(db);
+}
+
+/* JMD <type> <name> [mask] <property> [value] */
+static void journal_write_metadata(hook_metadata_req_t *req, const char *row)
+{
+	database_handle_t *db = journal_db;
+	const char *type;
+	chanacs_t *ca;
+
+	if ((type = metadata_db_type(req->target)) == NULL)
+		return;
+
+	db_start_row(db, row);
+	db_write_word(db, type);
+
+	if (!strcmp(type, "MDU"))
+		db_write_word(db, entity((myuser_t *)req->target)->name);
+	else if (!strcmp(type, "MDC"))
+		db_write_word(db, ((mychan_t *)req->target)->name);
+	else if (!strcmp(type, "MDA"))
+	{
+		ca = req->target;
+		db_write_word(db, ca->mychan->name);
+		db_write_word(db, ca->entity ? ca->entity->name : ca->host);
+	}
+	else
+		db_write_word(db, ((myuser_name_t *)req->target)->name);
+
+	db_write_word(db, req->name);
+	if (!strcmp(row, "JMD"))
+		db_write_str(db, req->value);
+	db_commit_row(db);
+}
+
+static void journal_write_all_metadata(void *target)
+{
+	hook_metadata_req_t req;
+	metadata_t *md;
+	unsigned int mdi;
+
+	METADATA_FOREACH(md, mdi, target)
+	{
+		req.target = target;
+		req.name = md->name;
+		req.value = md->value;
+		journal_write_metadata(&req, "JMD");
+	}
+}
+
+static void journal_flush_new(void *unused)
+{
+	mowgli_node_t *n, *tn, *cn;
+	myuser_t *mu;
+	mychan_t *mc;
+
+	journal_new_timer = NULL;
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, journal_new_myusers.head)
+	{
+		mu = n->data;
+		mowgli_node_delete(n, &journal_new_myusers);
+		mowgli_node_free(n);
+
+		if (!journal_active())
+			continue;
+
+		journal_write_myuser(mu);
+		MOWGLI_ITER_FOREACH(cn, mu->nicks.head)
+			journal_write_mynick(cn->data);
+		journal_write_all_metadata(mu);
+	}
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, journal_new_mychans.head)
+	{
+		mc = n->data;
+		mowgli_node_delete(n, &journal_new_mychans);
+		mowgli_node_free(n);
+
+		if (!journal_active())
+			continue;
+
+		journal_write_mychan(mc);
+		journal_write_all_metadata(mc);
+		MOWGLI_ITER_FOREACH(cn, mc->chanacs.head)
+		{
+			journal_write_chanacs(cn->data);
+			journal_write_all_metadata(cn->data);
+		}
+	}
+}
+
+static void journal_defer_new(void *obj, mowgli_list_t *list)
+{
+	mowgli_node_add(obj, mowgli_node_create(), list);
+
+	if (journal_new_timer == NULL)
+		journal_new_timer = mowgli_timer_add_once(base_eventloop, "journal_flush_new", journal_flush_new, NULL, 0);
+}
+
+static void journal_myuser_add(myuser_t *mu)
+{
+	if (!journal_active())
+		return;
+
+	journal_defer_new(mu, &journal_new_myusers);
+}
+
+static void journal_myuser_change(myuser_t *mu)
+{
+	/* set_password() is also called while an account is being created */
+	if (!journal_active() || myuser_find(entity(mu)->name) != mu || journal_myuser_is_new(mu))
+		return;
+
+	journal_write_myuser(mu);
+}
+
+static void journal_myuser_delete(myuser_t *mu)
+{
+	if (journal_myuser_is_new(mu))
+	{
+		journal_forget_new(mu, &journal_new_myusers);
+		return;
+	}
+
+	if (!journal_active())
+		return;
+
+	db_start_row(journal_db, "JMUD");
+	db_write_word(journal_db, entity(mu)->name);
+	db_commit_row(journal_db);
+}
+
+static void journal_user_rename(hook_user_rename_t *data)
+{
+	if (!journal_active() || journal_myuser_is_new(data->mu))
+		return;
+
+	db_start_row(journal_db, "JMUR");
+	db_write_word(journal_db, data->oldname);
+	db_write_word(journal_db, entity(data->mu)->name);
+	db_commit_row(journal_db);
+}
+
+static void journal_mynick_add(mynick_t *mn)
+{
+	if (!journal_active() || journal_myuser_is_new(mn->owner))
+		return;
+
+	journal_write_mynick(mn);
+}
+
+static void journal_mynick_delete(mynick_t *mn)
+{
+	if (!journal_active() || journal_myuser_is_new(mn->owner))
+		return;
+
+	db_start_row(journal_db, "JMND");
+	db_write_word(journal_db, mn->nick);
+	db_commit_row(journal_db);
+}
+
+static void journal_mychan_add(mychan_t *mc)
+{
+	if (!journal_active())
+		return;
+
+	journal_defer_new(mc, &journal_new_mychans);
+}
+
+static void journal_mychan_delete(mychan_t *mc)
+{
+	if (journal_mychan_is_new(mc))
+	{
+		journal_forget_new(mc, &journal_new_mychans);
+		return;
+	}
+
+	if (!journal_active())
+		return;
+
+	db_start_row(journal_db, "JMCD");
+	db_write_word(journal_db, mc->name);
+	db_commit_row(journal_db);
+}
+
+static void journal_chanacs_change(chanacs_t *ca)
+{
+	if (!journal_active() || journal_mychan_is_new(ca->mychan))
+		return;
+
+	journal_write_chanacs(ca);
+}
+
+static void journal_chanacs_delete(chanacs_t *ca)
+{
+	if (!journal_active() || journal_mychan_is_new(ca->mychan))
+		return;
+
+	db_start_row(journal_db, "JCAD");
+	db_write_word(journal_db, ca->mychan->name);
+	db_write_word(journal_db, ca->entity ? ca->entity->name : ca->host);
+	db_commit_row(journal_db);
+}
+
+/* metadata of a new account or channel is journaled along with it */
+static bool journal_metadata_is_new(void *target)
+{
+	const char *type = metadata_db_type(target);
+
+	if (type == NULL)
+		return false;
+	if (!strcmp(type, "MDU"))
+		return journal_myuser_is_new(target);
+	if (!strcmp(type, "MDC"))
+		return journal_mychan_is_new(target);
+	if (!strcmp(type, "MDA"))
+		return journal_mychan_is_new(((chanacs_t *)target)->mychan);
+
+	return false;
+}
+
+static void journal_metadata_add(hook_metadata_req_t *req)
+{
+	if (!journal_active() || journal_metadata_is_new(req->target))
+		return;
+
+	journal_write_metadata(req, "JMD");
+}
+
+static void journal_metadata_delete(hook_metadata_req_t *req)
+{
+	if (!journal_active() || journal_metadata_is_new(req->target))
+		return;
+
+	journal_write_metadata(req, "JMDD");
+}
+
+static void journal_kline_add(kline_t *k)
+{
+	database_handle_t *db = journal_db;
+
+	if (!journal_active())
+		return;
+
+	/* JKL <id> <user> <host> <duration> <settime> <setby> <reason> */
+	db_start_row(db, "JKL");
+	db_write_uint(db, k->number);
+	db_write_word(db, k->user);
+	db_write_word(db, k->host);
+	db_write_uint(db, k->duration);
+	db_write_time(db, k->settime);
+	db_write_word(db, k->setby);
+	db_write_str(db, k->reason);
+	db_commit_row(db);
+}
+
+static void journal_kline_delete(kline_t *k)
+{
+	if (!journal_active())
+		return;
+
+	db_start_row(journal_db, "JKLD");
+	db_write_uint(journal_db, k->number);
+	db_commit_row(journal_db);
+}
+
+/***************************************************************************************************/
+
+static void journal_h_mu(database_handle_t *db, const char *type)
+{
+	const char *uid, *name, *pass, *email, *sflags, *language;
+	time_t reg, login;
+	unsigned int flags = 0;
+	myuser_t *mu;
+
+	uid = db_sread_word(db);
+	name = db_sread_word(db);
+	pass = db_sread_word(db);
+	email = db_sread_word(db);
+	reg = db_sread_time(db);
+	login = db_sread_time(db);
+	sflags = db_sread_word(db);
+	language = db_sread_word(db);
+
+	if (!gflags_fromstr(mu_flags, sflags, &flags))
+		slog(LG_INFO, "journal-h-mu: line %d: confused by flags: %s", db->line, sflags);
+
+	if ((mu = myuser_find(name)) == NULL)
+		mu = myuser_add_id(uid, name, pass, email, flags | MU_CRYPTPASS);
+	else if (strcmp(mu->email, email))
+		myuser_set_email(mu, email);
+
+	mowgli_strlcpy(mu->pass, pass, PASSLEN);
+	mu->flags = flags;
+	mu->registered = reg;
+	mu->lastlogin = login;
+	mu->language = language_add(language);
+}
+
+static void journal_h_mud(database_handle_t *db, const char *type)
+{
+	myuser_t *mu;
+
+	if ((mu = myuser_find(db_sread_word(db))) != NULL)
+		object_unref(mu);
+}
+
+static void journal_h_mur(database_handle_t *db, const char *type)
+{
+	const char *oldname = db_sread_word(db);
+	const char *newname = db_sread_word(db);
+	myuser_t *mu;
+
+	if ((mu = myuser_find(oldname)) != NULL && myuser_find(newname) == NULL)
+		myuser_rename(mu, newname);
+}
+
+static void journal_h_mn(database_handle_t *db, const char *type)
+{
+	const char *user, *nick;
+	time_t reg, seen;
+	myuser_t *mu;
+	mynick_t *mn;
+
+	user = db_sread_word(db);
+	nick = db_sread_word(db);
+	reg = db_sread_time(db);
+	seen = db_sread_time(db);
+
+	if ((mu = myuser_find(user)) == NULL || mynick_find(nick) != NULL)
+		return;
+
+	mn = mynick_add(mu, nick);
+	mn->registered = reg;
+	mn->lastseen = seen;
+}
+
+static void journal_h_mnd(database_handle_t *db, const char *type)
+{
+	mynick_t *mn;
+
+	if ((mn = mynick_find(db_sread_word(db))) != NULL)
+		object_unref(mn);
+}
+
+static void journal_h_mc(database_handle_t *db, const char *type)
+{
+	char buf[4096];
+	const char *name, *sflags, *key;
+	unsigned int flags = 0;
+	mychan_t *mc;
+
+	name = db_sread_word(db);
+
+	if ((mc = mychan_find(name)) == NULL)
+	{
+		mowgli_strlcpy(buf, name, sizeof buf);
+		mc = mychan_add(buf);
+	}
+
+	mc->registered = db_sread_time(db);
+	mc->used = db_sread_time(db);
+
+	sflags = db_sread_word(db);
+	if (!gflags_fromstr(mc_flags, sflags, &flags))
+		slog(LG_INFO, "journal-h-mc: line %d: confused by flags %s", db->line, sflags);
+	mc->flags = flags;
+
+	mc->mlock_on = db_sread_uint(db);
+	mc->mlock_off = db_sread_uint(db);
+	mc->mlock_limit = db_sread_uint(db);
+
+	free(mc->mlock_key);
+	mc->mlock_key = NULL;
+	if ((key = db_read_word(db)) != NULL && *key != '\0')
+		mc->mlock_key = sstrdup(key);
+}
+
+static void journal_h_mcd(database_handle_t *db, const char *type)
+{
+	mychan_t *mc;
+
+	if ((mc = mychan_find(db_sread_word(db))) != NULL)
+		object_unref(mc);
+}
+
+static chanacs_t *journal_find_chanacs(mychan_t *mc, const char *target)
+{
+	myentity_t *mt;
+
+	if (mc == NULL)
+		return NULL;
+
+	if ((mt = myentity_find(target)) != NULL)
+		return chanacs_find_literal(mc, mt, 0);
+
+	return chanacs_find_host_literal(mc, target, 0);
+}
+
+static void journal_h_ca(database_handle_t *db, const char *type)
+{
+	const char *chan, *target;
+	unsigned int flags;
+	time_t tmod;
+	mychan_t *mc;
+	myentity_t *mt, *setter;
+	chanacs_t *ca;
+
+	chan = db_sread_word(db);
+	target = db_sread_word(db);
+	flags = flags_to_bitmask(db_sread_word(db), 0);
+	tmod = db_sread_time(db);
+	setter = myentity_find(db_sread_word(db));
+
+	if ((mc = mychan_find(chan)) == NULL)
+		return;
+
+	if ((ca = journal_find_chanacs(mc, target)) != NULL)
+	{
+		ca->level = flags & ca_all;
+		ca->tmodified = tmod;
+		chanacs_cache_invalidate_channel(mc);
+		return;
+	}
+
+	if ((mt = myentity_find(target)) != NULL)
+		chanacs_add(mc, mt, flags, tmod, setter);
+	else if (validhostmask(target))
+		chanacs_add_host(mc, target, flags, tmod, setter);
+}
+
+static void journal_h_cad(database_handle_t *db, const char *type)
+{
+	const char *chan = db_sread_word(db);
+	const char *target = db_sread_word(db);
+	chanacs_t *ca;
+
+	if ((ca = journal_find_chanacs(mychan_find(chan), target)) != NULL)
+		object_unref(ca);
+}
+
+static void *journal_find_metadata_target(database_handle_t *db, const char *mdtype)
+{
+	const char *name = db_sread_word(db);
+
+	if (!strcmp(mdtype, "MDU"))
+		return myuser_find(name);
+	else if (!strcmp(mdtype, "MDC"))
+		return mychan_find(name);
+	else if (!strcmp(mdtype, "MDA"))
+		return journal_find_chanacs(mychan_find(name), db_sread_word(db));
+	else if (!strcmp(mdtype, "MDN"))
+		return myuser_name_find(name);
+
+	slog(LG_INFO, "journal-h-md: line %d: unknown metadata type '%s'", db->line, mdtype);
+	return NULL;
+}
+
+static void journal_h_md(database_handle_t *db, const char *type)
+{
+	const char *mdtype = db_sread_word(db);
+	void *obj = journal_find_metadata_target(db, mdtype);
+	const char *prop = db_sread_word(db);
+	const char *value = db_sread_str(db);
+
+	if (obj != NULL)
+		metadata_add(obj, prop, value);
+}
+
+static void journal_h_mdd(database_handle_t *db, const char *type)
+{
+	const char *mdtype = db_sread_word(db);
+	void *obj = journal_find_metadata_target(db, mdtype);
+	const char *prop = db_sread_word(db);
+
+	if (obj != NULL)
+		metadata_delete(obj, prop);
+}
+
+static void journal_h_kl(database_handle_t *db, const char *type)
+{
+	const char *user, *host, *setby, *reason;
+	unsigned int id;
+	long duration;
+	time_t settime;
+	kline_t *k;
+
+	id = db_sread_uint(db);
+	user = db_sread_word(db);
+	host = db_sread_word(db);
+	duration = db_sread_uint(db);
+	settime = db_sread_time(db);
+	setby = db_sread_word(db);
+	reason = db_sread_str(db);
+
+	if (kline_find_num(id) != NULL)
+		return;
+
+	k = kline_add_with_id(user, host, reason, duration, setby, id);
+	k->settime = settime;
+	k->expires = k->settime + k->duration;
+
+	if (id > me.kline_id)
+		me.kline_id = id;
+}
+
+static void journal_h_kld(database_handle_t *db, const char *type)
+{
+	kline_t *k;
+
+	if ((k = kline_find_num(db_sread_uint(db))) != NULL)
+		kline_delete(k);
+}
+
+/***************************************************************************************************/
+
+/* Called just before a database write starts: everything journaled so far
+ * will be in that write, so it is moved aside and removed once the write
+ * has completed.  If an earlier write never completed, keep appending to
+ * the current journal; replaying the overlap is harmless.
+ */
+static void journal_db_save_start(void *unused)
+{
+	char oldpath[BUFSIZE], newpath[BUFSIZE];
+
+	if (journal_db == NULL || journal_pending)
+		return;
+
+	journal_close_write(journal_db);
+	journal_db = NULL;
+
+	journal_path(oldpath, sizeof oldpath, JOURNAL_FILE);
+	journal_path(newpath, sizeof newpath, JOURNAL_FILE_OLD);
+
+	if (srename(oldpath, newpath) < 0)
+		slog(LG_ERROR, "journal: cannot rename %s to %s: %s", oldpath, newpath, strerror(errno));
+	else
+		journal_pending = true;
+
+	journal_db = journal_open_write();
+}
+
+static void journal_db_saved(void *unused)
+{
+	char path[BUFSIZE];
+
+	if (!journal_pending)
+		return;
+
+	journal_path(path, sizeof path, JOURNAL_FILE_OLD);
+
+	if (unlink(path) < 0 && errno != ENOENT)
+	{
+		slog(LG_ERROR, "journal: cannot remove %s: %s", path, strerror(errno));
+		return;
+	}
+
+	journal_pending = false;
+}
+
+static void journal_shutdown(void *unused)
+{
+	journal_sync(NULL);
+}
+
+static void journal_config_ready(void *unused)
+{
+	if (journal_timer != NULL)
+	{
+		mowgli_timer_destroy(base_eventloop, journal_timer);
+		journal_timer = NULL;
+	}
+
+	if (journal_sync_interval != 0)
+		journal_timer = mowgli_timer_add(base_eventloop, "journal_sync", journal_sync, NULL, journal_sync_interval);
+}
+
+void _modinit(module_t *m)
+{
+	MODULE_TRY_REQUEST_DEPENDENCY(m, "backend/corestorage");
+
+	m->mflags = MODTYPE_CORE;
+
+	journal_db_load_next = db_load;
+	db_load = &journal_db_load;
+
+	add_duration_conf_item("JOURNAL_SYNC", &conf_db_table, 0, &journal_sync_interval, "s", 1);
+
+	db_register_type_handler("JMU", journal_h_mu);
+	db_register_type_handler("JMUD", journal_h_mud);
+	db_register_type_handler("JMUR", journal_h_mur);
+	db_register_type_handler("JMN", journal_h_mn);
+	db_register_type_handler("JMND", journal_h_mnd);
+	db_register_type_handler("JMC", journal_h_mc);
+	db_register_type_handler("JMCD", journal_h_mcd);
+	db_register_type_handler("JCA", journal_h_ca);
+	db_register_type_handler("JCAD", journal_h_cad);
+	db_register_type_handler("JMD", journal_h_md);
+	db_register_type_handler("JMDD", journal_h_mdd);
+	db_register_type_handler("JKL", journal_h_kl);
+	db_register_type_handler("JKLD", journal_h_kld);
+
+	hook_add_myuser_add(journal_myuser_add);
+	hook_add_myuser_change(journal_myuser_change);
+	hook_add_myuser_delete(journal_myuser_delete);
+	hook_add_user_rename(journal_user_rename);
+	hook_add_mynick_add(journal_mynick_add);
+	hook_add_mynick_delete(journal_mynick_delete);
+	hook_add_mychan_add(journal_mychan_add);
+	hook_add_mychan_delete(journal_mychan_delete);
+	hook_add_chanacs_change(journal_chanacs_change);
+	hook_add_chanacs_delete(journal_chanacs_delete);
+	hook_add_metadata_add(journal_metadata_add);
+	hook_add_metadata_delete(journal_metadata_delete);
+	hook_add_kline_add(journal_kline_add);
+	hook_add_kline_delete(journal_kline_delete);
+
+	hook_add_db_save_start(journal_db_save_start);
+	hook_add_db_saved(journal_db_saved);
+	hook_add_shutdown(journal_shutdown);
+	hook_add_config_ready(journal_config_ready);
+
+	/* loaded after the database: start journaling right away */
+	if (!(runflags & RF_STARTING) && !readonly)
+	{
+		journal_db = journal_open_write();
+		journal_config_ready(NULL);
+	}
+}
+
+/* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
+ * vim:ts=8
+ * vim:sw=8
+ * vim:noexpandtab
+ */
@@ -9,6 +9,17 @@
  */
 
 #include "atheme.h"
+#include "conf.h"
+
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
+#ifdef HAVE_ZLIB
+# include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+# include <zstd.h>
+#endif
 
 DECLARE_MODULE_V1
 (
@@ -17,26 +28,126 @@ DECLARE_MODULE_V1
 	VENDOR_STRING
 );
 
+/* The database is read and written in blocks of this size; a block is grown
+ * if a single row does not fit in it.
+ */
+#define OPENSEX_BLOCK		(1 << 20)
+
+/* Size of the buffer for compressed data */
+#define OPENSEX_CBLOCK		(1 << 18)
+
+enum {
+	OPENSEX_PLAIN,
+	OPENSEX_ZLIB,
+	OPENSEX_ZSTD
+};
+
+typedef struct {
+	int fd;
+	unsigned int type;
+
+	/* compressed data, or the start of an uncompressed database */
+	char *cbuf;
+	size_t cpos;
+	size_t clen;
+	bool eof;
+
+#ifdef HAVE_ZLIB
+	z_stream zs;
+#endif
+#ifdef HAVE_ZSTD
+	ZSTD_CStream *zcs;
+	ZSTD_DStream *zds;
+	size_t zhint;
+#endif
+} opensex_stream_t;
+
 typedef struct opensex_ {
 	/* Lexing state */
 	char *buf;
-	unsigned int bufsize;
+	size_t bufsize;
+	size_t buflen;
+	size_t bufpos;
+	bool eof;
 	char *token;
-	FILE *f;
+	char *rowend;
+	int fd;
+	opensex_stream_t stream;
+
+	/* Writing state */
+	int error;
+
+	/* Sectioned writing state: rows between start_cold and end_cold go
+	 * to a temporary file through the alternate buffer, which is appended
+	 * to the database as its cold section when it is closed.
+	 */
+	opensex_stream_t cold;
+	bool incold;
+	char *altbuf;
+	size_t altlen;
+	size_t altsize;
+	off_t hotlen;
+	off_t coldlen;
+	off_t runstart;
+	myuser_t *runmu;
+	mowgli_string_t *coldindex;
+
+#ifdef HAVE_PTHREAD
+	/* Pipelined reading state */
+	struct opensex_pipe_ *pipe;
+#endif
 
 	/* Interpreting state */
 	unsigned int grver;
+	bool lazy;
+	bool stop;
 } opensex_t;
 
+/* database::sync: fdatasync() a new database before it replaces the old one */
+static bool opensex_sync = false;
+
+/* database::compression: none, zlib or zstd */
+static char *opensex_compression = NULL;
+
+/* database::lazy_load: write the cold data of accounts into a separate
+ * section of the database, and only load it when needed.
+ */
+static bool opensex_lazy_load = false;
+
+/* The database file services were started from, which is kept open as long
+ * as accounts refer to its cold section, and where that section starts.
+ */
+static int opensex_cold_fd = -1;
+static off_t opensex_cold_base = 0;
+static char *opensex_cold_path = NULL;
+
 static void opensex_db_parse(database_handle_t *db)
 {
+	opensex_t *rs = (opensex_t *)db->priv;
 	const char *cmd;
-	while (db_read_next_row(db))
+	unsigned int rows = 0;
+	int ms = 0;
+#ifdef HAVE_GETTIMEOFDAY
+	struct timeval start, tv;
+
+	s_time(&start);
+#endif
+
+	while (!rs->stop && db_read_next_row(db))
 	{
 		cmd = db_read_word(db);
 		if (!cmd || !*cmd || strchr("#\n\t \r", *cmd)) continue;
+		rows++;
 		db_process(db, cmd);
 	}
+
+#ifdef HAVE_GETTIMEOFDAY
+	e_time(start, &tv);
+	ms = tv2ms(&tv);
+#endif
+
+	slog(LG_INFO, "opensex: loaded %u rows from %s in %d ms (%u rows/sec)", rows, db->file, ms,
+			ms > 0 ? (unsigned int)((unsigned long long)rows * 1000 / ms) : rows);
 }
 
 static void opensex_h_grver(database_handle_t *db, const char *type)
@@ -49,35 +160,512 @@ static void opensex_h_grver(database_handle_t *db, const char *type)
 		slog(LG_ERROR, "opensex: grammar version %d is unsupported.  dazed and confused, but trying to continue.", rs->grver);
 }
 
+/* A sectioned database ends with the cold section, preceded by an index of
+ * where the cold data of each account is in it:
+ *
+ *   MUC <account> <offset> <length>
+ *   SECTION cold <file offset of the cold section>
+ *
+ * When loading lazily, parsing stops at the SECTION row.  Otherwise the
+ * index is ignored and the rows in the cold section are loaded like all
+ * others.
+ */
+static void opensex_h_muc(database_handle_t *db, const char *type)
+{
+	opensex_t *rs = (opensex_t *)db->priv;
+	const char *name = db_sread_word(db);
+	unsigned long long offset = strtoull(db_sread_word(db), NULL, 10);
+	unsigned long long len = strtoull(db_sread_word(db), NULL, 10);
+	myuser_t *mu;
+
+	if (!rs->lazy)
+		return;
+
+	if ((mu = myuser_find(name)) == NULL)
+	{
+		slog(LG_INFO, "db-h-muc: line %d: cold data for nonexistent account %s", db->line, name);
+		return;
+	}
+
+	mu->cold_offset = offset;
+	mu->cold_len = len;
+}
+
+static void opensex_h_section(database_handle_t *db, const char *type)
+{
+	opensex_t *rs = (opensex_t *)db->priv;
+	const char *section = db_sread_word(db);
+	unsigned long long base = strtoull(db_sread_word(db), NULL, 10);
+	int fd;
+
+	if (!rs->lazy || strcmp(section, "cold"))
+		return;
+
+	if ((fd = dup(rs->fd)) < 0)
+	{
+		slog(LG_ERROR, "db-h-section: cannot keep %s open: %s", db->file, strerror(errno));
+		slog(LG_ERROR, "db-h-section: exiting to avoid data loss");
+		exit(EXIT_FAILURE);
+	}
+
+	if (opensex_cold_fd >= 0)
+		close(opensex_cold_fd);
+	free(opensex_cold_path);
+
+	opensex_cold_fd = fd;
+	opensex_cold_base = base;
+	opensex_cold_path = sstrdup(db->file);
+
+	rs->stop = true;
+}
+
 /***************************************************************************************************/
 
-static bool opensex_read_next_row(database_handle_t *hdl)
+/***************************************************************************************************/
+
+/* Databases can be compressed with zlib (gzip format) or zstd.  A compressed
+ * database is recognised by its magic number when it is read, so changing
+ * database::compression only affects how the next database is written.
+ */
+
+static unsigned int opensex_compression_get(void)
 {
-	int c = 0;
-	unsigned int n = 0;
-	opensex_t *rs = (opensex_t *)hdl->priv;
+	if (opensex_compression == NULL || !strcasecmp(opensex_compression, "none"))
+		return OPENSEX_PLAIN;
+#ifdef HAVE_ZLIB
+	if (!strcasecmp(opensex_compression, "zlib"))
+		return OPENSEX_ZLIB;
+#endif
+#ifdef HAVE_ZSTD
+	if (!strcasecmp(opensex_compression, "zstd"))
+		return OPENSEX_ZSTD;
+#endif
+
+	slog(LG_ERROR, "opensex: compression '%s' is not supported, writing an uncompressed database", opensex_compression);
+	return OPENSEX_PLAIN;
+}
+
+static ssize_t opensex_stream_fill(opensex_stream_t *st)
+{
+	ssize_t n;
+
+	while ((n = read(st->fd, st->cbuf, OPENSEX_CBLOCK)) < 0 && errno == EINTR)
+		;
+
+	return n;
+}
+
+/* Sets up a stream for reading, working out whether the database is
+ * compressed from its first bytes.
+ */
+static bool opensex_stream_open_read(opensex_stream_t *st, int fd, const char *path)
+{
+	static const unsigned char gzip_magic[] = { 0x1f, 0x8b };
+	static const unsigned char zstd_magic[] = { 0x28, 0xb5, 0x2f, 0xfd };
+	ssize_t n;
+
+	st->fd = fd;
+	st->cbuf = smalloc(OPENSEX_CBLOCK);
+
+	/* the magic is looked for in the first block; a short first read
+	 * only happens for files too small to be compressed databases.
+	 */
+	if ((n = opensex_stream_fill(st)) < 0)
+	{
+		slog(LG_ERROR, "db-open-read: cannot read '%s': %s", path, strerror(errno));
+		return false;
+	}
+	st->cpos = 0;
+	st->clen = n;
 
-	while ((c = getc(rs->f)) != EOF && c != '\n')
+	if (st->clen >= sizeof gzip_magic && !memcmp(st->cbuf, gzip_magic, sizeof gzip_magic))
 	{
-		rs->buf[n++] = c;
-		if (n == rs->bufsize)
+#ifdef HAVE_ZLIB
+		st->type = OPENSEX_ZLIB;
+		memset(&st->zs, 0, sizeof st->zs);
+		st->zs.next_in = (Bytef *)st->cbuf;
+		st->zs.avail_in = st->clen;
+
+		/* 15 + 32: maximum window, zlib or gzip header */
+		if (inflateInit2(&st->zs, 15 + 32) != Z_OK)
 		{
-			rs->bufsize *= 2;
-			rs->buf = srealloc(rs->buf, rs->bufsize);
+			slog(LG_ERROR, "db-open-read: cannot initialise zlib for '%s'", path);
+			return false;
+		}
+#else
+		slog(LG_ERROR, "db-open-read: '%s' is compressed with zlib, but zlib support is not compiled in", path);
+		return false;
+#endif
+	}
+	else if (st->clen >= sizeof zstd_magic && !memcmp(st->cbuf, zstd_magic, sizeof zstd_magic))
+	{
+#ifdef HAVE_ZSTD
+		st->type = OPENSEX_ZSTD;
+		if ((st->zds = ZSTD_createDStream()) == NULL || ZSTD_isError(ZSTD_initDStream(st->zds)))
+		{
+			slog(LG_ERROR, "db-open-read: cannot initialise zstd for '%s'", path);
+			return false;
+		}
+#else
+		slog(LG_ERROR, "db-open-read: '%s' is compressed with zstd, but zstd support is not compiled in", path);
+		return false;
+#endif
+	}
+	else
+		st->type = OPENSEX_PLAIN;
+
+	return true;
+}
+
+/* Reads up to len bytes of database text.  Returns 0 at the end of the
+ * database and -1 with errno set on error.  This is called from the reader
+ * thread, so it must not log.
+ */
+static ssize_t opensex_stream_read(opensex_stream_t *st, char *buf, size_t len)
+{
+	ssize_t n;
+
+	if (st->type == OPENSEX_PLAIN)
+	{
+		if (st->cpos < st->clen)
+		{
+			n = st->clen - st->cpos < len ? st->clen - st->cpos : len;
+			memcpy(buf, st->cbuf + st->cpos, n);
+			st->cpos += n;
+			return n;
+		}
+
+		while ((n = read(st->fd, buf, len)) < 0 && errno == EINTR)
+			;
+		return n;
+	}
+
+#ifdef HAVE_ZLIB
+	if (st->type == OPENSEX_ZLIB)
+	{
+		int ret;
+
+		st->zs.next_out = (Bytef *)buf;
+		st->zs.avail_out = len;
+
+		while (st->zs.avail_out == len)
+		{
+			if (st->zs.avail_in == 0 && !st->eof)
+			{
+				if ((n = opensex_stream_fill(st)) < 0)
+					return -1;
+				st->eof = n == 0;
+				st->zs.next_in = (Bytef *)st->cbuf;
+				st->zs.avail_in = n;
+			}
+
+			ret = inflate(&st->zs, Z_NO_FLUSH);
+			if (ret == Z_STREAM_END)
+			{
+				/* gzip files may consist of several members */
+				if (st->zs.avail_in == 0 && !st->eof)
+				{
+					if ((n = opensex_stream_fill(st)) < 0)
+						return -1;
+					st->eof = n == 0;
+					st->zs.next_in = (Bytef *)st->cbuf;
+					st->zs.avail_in = n;
+				}
+
+				if (st->zs.avail_in == 0)
+					break;
+				inflateReset(&st->zs);
+			}
+			else if (ret == Z_BUF_ERROR && st->eof)
+			{
+				/* truncated */
+				errno = EIO;
+				return -1;
+			}
+			else if (ret != Z_OK && ret != Z_BUF_ERROR)
+			{
+				errno = EIO;
+				return -1;
+			}
+		}
+
+		return len - st->zs.avail_out;
+	}
+#endif
+
+#ifdef HAVE_ZSTD
+	if (st->type == OPENSEX_ZSTD)
+	{
+		ZSTD_outBuffer out = { buf, len, 0 };
+		ZSTD_inBuffer in;
+
+		while (out.pos == 0)
+		{
+			if (st->cpos == st->clen)
+			{
+				if (st->eof)
+				{
+					/* a non-zero hint means the frame is truncated */
+					if (st->zhint != 0)
+					{
+						errno = EIO;
+						return -1;
+					}
+					break;
+				}
+
+				if ((n = opensex_stream_fill(st)) < 0)
+					return -1;
+				st->eof = n == 0;
+				st->cpos = 0;
+				st->clen = n;
+			}
+
+			in.src = st->cbuf;
+			in.size = st->clen;
+			in.pos = st->cpos;
+
+			st->zhint = ZSTD_decompressStream(st->zds, &out, &in);
+			if (ZSTD_isError(st->zhint))
+			{
+				errno = EIO;
+				return -1;
+			}
+
+			st->cpos = in.pos;
+		}
+
+		return out.pos;
+	}
+#endif
+
+	errno = EINVAL;
+	return -1;
+}
+
+static bool opensex_stream_open_write(opensex_stream_t *st, int fd)
+{
+	st->fd = fd;
+	st->type = opensex_compression_get();
+	st->cbuf = smalloc(OPENSEX_CBLOCK);
+
+#ifdef HAVE_ZLIB
+	if (st->type == OPENSEX_ZLIB)
+	{
+		memset(&st->zs, 0, sizeof st->zs);
+
+		/* 15 + 16: maximum window, gzip header */
+		if (deflateInit2(&st->zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			return false;
+	}
+#endif
+
+#ifdef HAVE_ZSTD
+	if (st->type == OPENSEX_ZSTD)
+	{
+		if ((st->zcs = ZSTD_createCStream()) == NULL || ZSTD_isError(ZSTD_initCStream(st->zcs, ZSTD_CLEVEL_DEFAULT)))
+			return false;
+	}
+#endif
+
+	return true;
+}
+
+static int opensex_stream_write_raw(opensex_stream_t *st, const char *data, size_t len)
+{
+	size_t off = 0;
+	ssize_t n;
+
+	while (off < len)
+	{
+		if ((n = write(st->fd, data + off, len - off)) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+
+		off += n;
+	}
+
+	return 0;
+}
+
+/* Writes len bytes of database text, compressing them if needed.  With
+ * finish set, the compressed stream is ended as well.  Returns 0 or an
+ * errno value.
+ */
+static int opensex_stream_write(opensex_stream_t *st, const char *data, size_t len, bool finish)
+{
+	int error;
+
+	if (st->type == OPENSEX_PLAIN)
+		return opensex_stream_write_raw(st, data, len);
+
+#ifdef HAVE_ZLIB
+	if (st->type == OPENSEX_ZLIB)
+	{
+		int ret;
+
+		st->zs.next_in = (Bytef *)data;
+		st->zs.avail_in = len;
+
+		do
+		{
+			st->zs.next_out = (Bytef *)st->cbuf;
+			st->zs.avail_out = OPENSEX_CBLOCK;
+
+			ret = deflate(&st->zs, finish ? Z_FINISH : Z_NO_FLUSH);
+			if (ret == Z_STREAM_ERROR)
+				return EIO;
+
+			if ((error = opensex_stream_write_raw(st, st->cbuf, OPENSEX_CBLOCK - st->zs.avail_out)) != 0)
+				return error;
+		} while (st->zs.avail_out == 0 || (finish && ret != Z_STREAM_END));
+
+		return 0;
+	}
+#endif
+
+#ifdef HAVE_ZSTD
+	if (st->type == OPENSEX_ZSTD)
+	{
+		ZSTD_inBuffer in = { data, len, 0 };
+		ZSTD_outBuffer out;
+		size_t ret;
+
+		while (in.pos < in.size)
+		{
+			out.dst = st->cbuf;
+			out.size = OPENSEX_CBLOCK;
+			out.pos = 0;
+
+			if (ZSTD_isError(ZSTD_compressStream(st->zcs, &out, &in)))
+				return EIO;
+
+			if ((error = opensex_stream_write_raw(st, st->cbuf, out.pos)) != 0)
+				return error;
+		}
+
+		if (finish)
+		{
+			do
+			{
+				out.dst = st->cbuf;
+				out.size = OPENSEX_CBLOCK;
+				out.pos = 0;
+
+				if (ZSTD_isError(ret = ZSTD_endStream(st->zcs, &out)))
+					return EIO;
+
+				if ((error = opensex_stream_write_raw(st, st->cbuf, out.pos)) != 0)
+					return error;
+			} while (ret != 0);
 		}
+
+		return 0;
 	}
-	rs->buf[n] = '\0';
-	rs->token = rs->buf;
+#endif
+
+	return EINVAL;
+}
 
-	if (c == EOF && ferror(rs->f))
+static void opensex_stream_close(opensex_stream_t *st, database_transaction_t txn)
+{
+#ifdef HAVE_ZLIB
+	if (st->type == OPENSEX_ZLIB)
+	{
+		if (txn == DB_WRITE)
+			deflateEnd(&st->zs);
+		else
+			inflateEnd(&st->zs);
+	}
+#endif
+
+#ifdef HAVE_ZSTD
+	if (st->zcs != NULL)
+		ZSTD_freeCStream(st->zcs);
+	if (st->zds != NULL)
+		ZSTD_freeDStream(st->zds);
+#endif
+
+	free(st->cbuf);
+}
+
+/* Refills the read buffer, keeping the unconsumed part of it.  Returns false
+ * once the end of the file has been reached and nothing new was read.
+ */
+static bool opensex_fill(database_handle_t *hdl)
+{
+	opensex_t *rs = (opensex_t *)hdl->priv;
+	ssize_t n;
+
+	if (rs->eof)
+		return false;
+
+	if (rs->bufpos > 0)
+	{
+		memmove(rs->buf, rs->buf + rs->bufpos, rs->buflen - rs->bufpos);
+		rs->buflen -= rs->bufpos;
+		rs->bufpos = 0;
+	}
+
+	/* keep room for the terminating NUL */
+	if (rs->buflen + 1 >= rs->bufsize)
+	{
+		rs->bufsize *= 2;
+		rs->buf = srealloc(rs->buf, rs->bufsize);
+	}
+
+	if ((n = opensex_stream_read(&rs->stream, rs->buf + rs->buflen, rs->bufsize - rs->buflen - 1)) < 0)
 	{
 		slog(LG_ERROR, "opensex-read-next-row: error at %s line %d: %s", hdl->file, hdl->line, strerror(errno));
 		slog(LG_ERROR, "opensex-read-next-row: exiting to avoid data loss");
 		exit(EXIT_FAILURE);
 	}
 
-	if (c == EOF && n == 0)
+	if (n == 0)
+	{
+		rs->eof = true;
 		return false;
+	}
+
+	rs->buflen += n;
+	return true;
+}
+
+static bool opensex_read_next_row(database_handle_t *hdl)
+{
+	opensex_t *rs = (opensex_t *)hdl->priv;
+	char *row, *nl;
+	size_t scanned = 0;
+
+	for (;;)
+	{
+		row = rs->buf + rs->bufpos;
+		nl = memchr(row + scanned, '\n', rs->buflen - rs->bufpos - scanned);
+		if (nl != NULL)
+			break;
+
+		scanned = rs->buflen - rs->bufpos;
+		if (!opensex_fill(hdl))
+		{
+			/* last row without a newline */
+			if (rs->bufpos == rs->buflen)
+				return false;
+
+			nl = rs->buf + rs->buflen;
+			row = rs->buf + rs->bufpos;
+			break;
+		}
+	}
+
+	*nl = '\0';
+	rs->token = row;
+	rs->rowend = nl;
+	rs->bufpos = nl - rs->buf;
+	if (rs->bufpos < rs->buflen)
+		rs->bufpos++;
 
 	hdl->line++;
 	hdl->token = 0;
@@ -87,15 +675,14 @@ static bool opensex_read_next_row(database_handle_t *hdl)
 static const char *opensex_read_word(database_handle_t *db)
 {
 	opensex_t *rs = (opensex_t *)db->priv;
-	char *ptr = rs->token;
+	char *ptr;
 	char *res;
-	static char buf[BUFSIZE];
 
 	res = rs->token;
 	if (res == NULL)
 		return NULL;
 
-	ptr = strchr(res, ' ');
+	ptr = memchr(res, ' ', rs->rowend - res);
 	if (ptr != NULL)
 	{
 		*ptr++ = '\0';
@@ -120,37 +707,130 @@ static const char *opensex_read_str(database_handle_t *db)
 	return res;
 }
 
+/* The database only ever contains plain decimal numbers, so these do not go
+ * through strtol() and friends.
+ */
+static bool opensex_parse_ulong(const char *s, unsigned long *res)
+{
+	unsigned long v = 0;
+
+	if (*s == '\0')
+		return false;
+
+	for (; *s >= '0' && *s <= '9'; s++)
+		v = v * 10 + (*s - '0');
+
+	*res = v;
+	return *s == '\0';
+}
+
 static bool opensex_read_int(database_handle_t *db, int *res)
 {
 	const char *s = db_read_word(db);
-	char *rp;
+	unsigned long v;
+	bool neg;
 
 	if (!s) return false;
 
-	*res = strtol(s, &rp, 0);
-	return *s && !*rp;
+	if ((neg = (*s == '-')))
+		s++;
+
+	if (!opensex_parse_ulong(s, &v))
+		return false;
+
+	*res = neg ? -(int)v : (int)v;
+	return true;
 }
 
 static bool opensex_read_uint(database_handle_t *db, unsigned int *res)
 {
 	const char *s = db_read_word(db);
-	char *rp;
+	unsigned long v;
 
 	if (!s) return false;
 
-	*res = strtoul(s, &rp, 0);
-	return *s && !*rp;
+	if (!opensex_parse_ulong(s, &v))
+		return false;
+
+	*res = v;
+	return true;
 }
 
 static bool opensex_read_time(database_handle_t *db, time_t *res)
 {
 	const char *s = db_read_word(db);
-	char *rp;
+	unsigned long v;
 
 	if (!s) return false;
 
-	*res = strtoul(s, &rp, 0);
-	return *s && !*rp;
+	if (!opensex_parse_ulong(s, &v))
+		return false;
+
+	*res = v;
+	return true;
+}
+
+/* Writes out the buffered rows.  A write error is remembered and reported
+ * when the database is closed, so that the old database is kept.
+ */
+static void opensex_flush(opensex_t *rs, bool finish)
+{
+	if (rs->incold)
+	{
+		if (rs->error == 0)
+			rs->error = opensex_stream_write_raw(&rs->cold, rs->buf, rs->buflen);
+		rs->coldlen += rs->buflen;
+	}
+	else
+	{
+		if (rs->error == 0)
+			rs->error = opensex_stream_write(&rs->stream, rs->buf, rs->buflen, finish);
+		rs->hotlen += rs->buflen;
+	}
+
+	rs->buflen = 0;
+}
+
+/* Switches between writing to the database and to its cold section. */
+static void opensex_swap(opensex_t *rs)
+{
+	char *buf = rs->buf;
+	size_t buflen = rs->buflen, bufsize = rs->bufsize;
+
+	rs->buf = rs->altbuf;
+	rs->buflen = rs->altlen;
+	rs->bufsize = rs->altsize;
+
+	rs->altbuf = buf;
+	rs->altlen = buflen;
+	rs->altsize = bufsize;
+
+	rs->incold = !rs->incold;
+}
+
+static inline void opensex_append(opensex_t *rs, const char *data, size_t len)
+{
+	if (rs->buflen + len > rs->bufsize)
+	{
+		while (rs->buflen + len > rs->bufsize)
+			rs->bufsize *= 2;
+		rs->buf = srealloc(rs->buf, rs->bufsize);
+	}
+
+	memcpy(rs->buf + rs->buflen, data, len);
+	rs->buflen += len;
+}
+
+/* Formats num in decimal just before end, returning where it starts. */
+static inline char *opensex_ultoa(unsigned long num, char *end)
+{
+	do
+	{
+		*--end = '0' + num % 10;
+		num /= 10;
+	} while (num != 0);
+
+	return end;
 }
 
 static bool opensex_start_row(database_handle_t *db, const char *type)
@@ -161,7 +841,8 @@ static bool opensex_start_row(database_handle_t *db, const char *type)
 	return_val_if_fail(type != NULL, false);
 	rs = (opensex_t *)db->priv;
 
-	fprintf(rs->f, "%s ", type);
+	opensex_append(rs, type, strlen(type));
+	opensex_append(rs, " ", 1);
 
 	return true;
 }
@@ -169,13 +850,16 @@ static bool opensex_start_row(database_handle_t *db, const char *type)
 static bool opensex_write_cell(database_handle_t *db, const char *data, bool multiword)
 {
 	opensex_t *rs;
-	char buf[BUFSIZE], *bi;
-	const char *i;
 
 	return_val_if_fail(db != NULL, false);
 	rs = (opensex_t *)db->priv;
 
-	fprintf(rs->f, "%s%s", data != NULL ? data : "*", !multiword ? " " : "");
+	if (data == NULL)
+		data = "*";
+
+	opensex_append(rs, data, strlen(data));
+	if (!multiword)
+		opensex_append(rs, " ", 1);
 
 	return true;
 }
@@ -190,25 +874,40 @@ static bool opensex_write_str(database_handle_t *db, const char *word)
 	return opensex_write_cell(db, word, true);
 }
 
+static bool opensex_write_number(database_handle_t *db, unsigned long num, bool neg)
+{
+	opensex_t *rs;
+	char buf[32], *p;
+
+	return_val_if_fail(db != NULL, false);
+	rs = (opensex_t *)db->priv;
+
+	buf[sizeof buf - 1] = ' ';
+	p = opensex_ultoa(num, buf + sizeof buf - 1);
+	if (neg)
+		*--p = '-';
+
+	opensex_append(rs, p, buf + sizeof buf - p);
+
+	return true;
+}
+
 static bool opensex_write_int(database_handle_t *db, int num)
 {
-	char buf[32];
-	snprintf(buf, sizeof buf, "%d", num);
-	return opensex_write_cell(db, buf, false);
+	if (num < 0)
+		return opensex_write_number(db, -(unsigned long)num, true);
+
+	return opensex_write_number(db, num, false);
 }
 
 static bool opensex_write_uint(database_handle_t *db, unsigned int num)
 {
-	char buf[32];
-	snprintf(buf, sizeof buf, "%u", num);
-	return opensex_write_cell(db, buf, false);
+	return opensex_write_number(db, num, false);
 }
 
 static bool opensex_write_time(database_handle_t *db, time_t tm)
 {
-	char buf[32];
-	snprintf(buf, sizeof buf, "%lu", tm);
-	return opensex_write_cell(db, buf, false);
+	return opensex_write_number(db, (unsigned long)tm, false);
 }
 
 static bool opensex_commit_row(database_handle_t *db)
@@ -218,11 +917,141 @@ static bool opensex_commit_row(database_handle_t *db)
 	return_val_if_fail(db != NULL, false);
 	rs = (opensex_t *)db->priv;
 
-	fprintf(rs->f, "\n");
+	opensex_append(rs, "\n", 1);
+
+	if (rs->buflen >= OPENSEX_BLOCK)
+		opensex_flush(rs, false);
 
 	return true;
 }
 
+static bool opensex_start_cold(database_handle_t *db, myuser_t *mu)
+{
+	opensex_t *rs;
+	off_t pos;
+	ssize_t n;
+	size_t done;
+
+	return_val_if_fail(db != NULL, false);
+	return_val_if_fail(mu != NULL, false);
+	rs = (opensex_t *)db->priv;
+
+	if (rs->cold.fd < 0)
+		return false;
+
+	if (!rs->incold)
+		opensex_swap(rs);
+
+	rs->runstart = rs->coldlen + rs->buflen;
+	rs->runmu = mu;
+
+	if (mu->cold_len == 0)
+		return true;
+
+	/* copy the rows from the database services were started from */
+	if (rs->buflen + mu->cold_len > rs->bufsize)
+	{
+		while (rs->buflen + mu->cold_len > rs->bufsize)
+			rs->bufsize *= 2;
+		rs->buf = srealloc(rs->buf, rs->bufsize);
+	}
+
+	pos = opensex_cold_base + mu->cold_offset;
+	for (done = 0; done < mu->cold_len; done += n)
+	{
+		if ((n = pread(opensex_cold_fd, rs->buf + rs->buflen + done, mu->cold_len - done, pos + done)) <= 0)
+		{
+			if (n < 0 && errno == EINTR)
+			{
+				n = 0;
+				continue;
+			}
+
+			if (rs->error == 0)
+				rs->error = n < 0 ? errno : EIO;
+			return true;
+		}
+	}
+
+	rs->buflen += mu->cold_len;
+	if (rs->buflen >= OPENSEX_BLOCK)
+		opensex_flush(rs, false);
+
+	return true;
+}
+
+static void opensex_end_cold(database_handle_t *db)
+{
+	opensex_t *rs;
+	off_t len;
+	char buf[BUFSIZE];
+
+	return_if_fail(db != NULL);
+	rs = (opensex_t *)db->priv;
+
+	if (!rs->incold)
+		return;
+
+	len = rs->coldlen + rs->buflen - rs->runstart;
+	opensex_swap(rs);
+
+	if (len == 0)
+		return;
+
+	snprintf(buf, sizeof buf, "MUC %s %llu %llu\n", entity(rs->runmu)->name,
+			(unsigned long long)rs->runstart, (unsigned long long)len);
+	rs->coldindex->append(rs->coldindex, buf, strlen(buf));
+}
+
+/* Appends the cold section to a sectioned database. */
+static void opensex_write_cold(opensex_t *rs)
+{
+	char row[BUFSIZE];
+	off_t base, start;
+	ssize_t n;
+	size_t rowlen;
+
+	/* write out the rest of the cold section */
+	opensex_swap(rs);
+	opensex_flush(rs, false);
+	opensex_swap(rs);
+
+	opensex_append(rs, rs->coldindex->str, rs->coldindex->pos);
+
+	/* the SECTION row gives the offset of the row after it, which
+	 * depends on its own length.
+	 */
+	start = rs->hotlen + rs->buflen;
+	rowlen = 0;
+	do
+	{
+		base = start + rowlen;
+		rowlen = snprintf(row, sizeof row, "SECTION cold %llu\n", (unsigned long long)base);
+	} while (start + (off_t)rowlen != base);
+	opensex_append(rs, row, rowlen);
+	opensex_flush(rs, false);
+
+	if (rs->error == 0 && lseek(rs->cold.fd, 0, SEEK_SET) < 0)
+		rs->error = errno;
+
+	while (rs->error == 0)
+	{
+		if ((n = read(rs->cold.fd, rs->buf, rs->bufsize)) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			rs->error = errno;
+			break;
+		}
+
+		if (n == 0)
+			break;
+
+		rs->buflen = n;
+		opensex_flush(rs, false);
+	}
+}
+
 static database_vtable_t opensex_vt = {
 	.name = "opensex",
 
@@ -240,20 +1069,446 @@ static database_vtable_t opensex_vt = {
 	.write_int = opensex_write_int,
 	.write_uint = opensex_write_uint,
 	.write_time = opensex_write_time,
-	.commit_row = opensex_commit_row
+	.commit_row = opensex_commit_row,
+
+	.start_cold = opensex_start_cold,
+	.end_cold = opensex_end_cold
 };
 
+#ifdef HAVE_PTHREAD
+/***************************************************************************************************/
+
+/* Pipelined loading: a reader thread reads the database, splits it into rows
+ * and cells and decodes numbers, handing batches of rows to the main thread,
+ * which only has to run the row handlers.  The handlers run in file order on
+ * the main thread, exactly as without the pipeline.
+ */
+
+#define OPENSEX_QUEUE		8
+
+typedef struct {
+	char *start;
+	char *end;
+	unsigned long num;
+	enum { OPENSEX_CELL_WORD, OPENSEX_CELL_NUM, OPENSEX_CELL_NEGNUM } type;
+} opensex_cell_t;
+
+typedef struct {
+	unsigned int cell;
+	unsigned int ncells;
+} opensex_row_t;
+
+typedef struct opensex_batch_ {
+	char *buf;
+	size_t bufsize;
+	size_t buflen;
+
+	opensex_row_t *rows;
+	unsigned int nrows;
+	unsigned int rowsize;
+
+	opensex_cell_t *cells;
+	unsigned int ncells;
+	unsigned int cellsize;
+
+	/* set on the last batch */
+	bool last;
+	int error;
+} opensex_batch_t;
+
+typedef struct opensex_pipe_ {
+	opensex_stream_t *stream;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	opensex_batch_t *queue[OPENSEX_QUEUE];
+	unsigned int qhead;
+	unsigned int qlen;
+	bool stop;
+
+	/* Main thread state */
+	opensex_batch_t *batch;
+	unsigned int row;
+	unsigned int cell;
+	unsigned int cellend;
+} opensex_pipe_t;
+
+static opensex_batch_t *opensex_batch_create(size_t size)
+{
+	opensex_batch_t *b = scalloc(sizeof(opensex_batch_t), 1);
+
+	b->bufsize = size;
+	b->buf = smalloc(b->bufsize);
+	b->rowsize = 1024;
+	b->rows = smalloc(b->rowsize * sizeof(opensex_row_t));
+	b->cellsize = 8192;
+	b->cells = smalloc(b->cellsize * sizeof(opensex_cell_t));
+
+	return b;
+}
+
+static void opensex_batch_destroy(opensex_batch_t *b)
+{
+	free(b->buf);
+	free(b->rows);
+	free(b->cells);
+	free(b);
+}
+
+static void opensex_batch_add_cell(opensex_batch_t *b, char *start, char *end)
+{
+	opensex_cell_t *c;
+	const char *p = start;
+
+	if (b->ncells == b->cellsize)
+	{
+		b->cellsize *= 2;
+		b->cells = srealloc(b->cells, b->cellsize * sizeof(opensex_cell_t));
+	}
+
+	c = &b->cells[b->ncells++];
+	c->start = start;
+	c->end = end;
+	c->num = 0;
+	c->type = OPENSEX_CELL_WORD;
+
+	if (p < end && *p == '-')
+		p++;
+	if (p == end)
+		return;
+
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+		c->num = c->num * 10 + (*p - '0');
+
+	if (p == end)
+		c->type = *start == '-' ? OPENSEX_CELL_NEGNUM : OPENSEX_CELL_NUM;
+}
+
+/* Splits a NUL-terminated row into cells at every space, like
+ * opensex_read_word() does.  Cells are not NUL-terminated yet, so that
+ * opensex_pipe_read_str() can still return the rest of the row.
+ */
+static void opensex_batch_add_row(opensex_batch_t *b, char *start, char *end)
+{
+	opensex_row_t *r;
+	char *sp;
+
+	if (b->nrows == b->rowsize)
+	{
+		b->rowsize *= 2;
+		b->rows = srealloc(b->rows, b->rowsize * sizeof(opensex_row_t));
+	}
+
+	r = &b->rows[b->nrows++];
+	r->cell = b->ncells;
+
+	while ((sp = memchr(start, ' ', end - start)) != NULL)
+	{
+		opensex_batch_add_cell(b, start, sp);
+		start = sp + 1;
+	}
+	opensex_batch_add_cell(b, start, end);
+
+	r->ncells = b->ncells - r->cell;
+}
+
+static bool opensex_pipe_push(opensex_pipe_t *pp, opensex_batch_t *b)
+{
+	bool stop;
+
+	pthread_mutex_lock(&pp->lock);
+	while (pp->qlen == OPENSEX_QUEUE && !pp->stop)
+		pthread_cond_wait(&pp->cond, &pp->lock);
+
+	if (!(stop = pp->stop))
+	{
+		pp->queue[(pp->qhead + pp->qlen) % OPENSEX_QUEUE] = b;
+		pp->qlen++;
+		pthread_cond_signal(&pp->cond);
+	}
+	pthread_mutex_unlock(&pp->lock);
+
+	if (stop)
+		opensex_batch_destroy(b);
+
+	return !stop;
+}
+
+static opensex_batch_t *opensex_pipe_pop(opensex_pipe_t *pp)
+{
+	opensex_batch_t *b;
+
+	pthread_mutex_lock(&pp->lock);
+	while (pp->qlen == 0)
+		pthread_cond_wait(&pp->cond, &pp->lock);
+
+	b = pp->queue[pp->qhead];
+	pp->qhead = (pp->qhead + 1) % OPENSEX_QUEUE;
+	pp->qlen--;
+	pthread_cond_signal(&pp->cond);
+	pthread_mutex_unlock(&pp->lock);
+
+	return b;
+}
+
+/* The reader thread must not log or touch any services state; errors are
+ * passed on in the last batch.
+ */
+static void *opensex_pipe_reader(void *arg)
+{
+	opensex_pipe_t *pp = arg;
+	opensex_batch_t *b, *next;
+	char *p, *nl, *end;
+	size_t scanned;
+	ssize_t n;
+
+	b = opensex_batch_create(OPENSEX_BLOCK);
+
+	for (;;)
+	{
+		/* read until there is at least one complete row */
+		scanned = 0;
+		while (!b->last)
+		{
+			if (b->buflen + 1 >= b->bufsize)
+			{
+				b->bufsize *= 2;
+				b->buf = srealloc(b->buf, b->bufsize);
+			}
+
+			if ((n = opensex_stream_read(pp->stream, b->buf + b->buflen, b->bufsize - b->buflen - 1)) < 0)
+			{
+				b->error = errno;
+				b->last = true;
+			}
+			else if (n == 0)
+				b->last = true;
+			else
+			{
+				b->buflen += n;
+				if (memchr(b->buf + scanned, '\n', b->buflen - scanned) != NULL)
+					break;
+				scanned = b->buflen;
+			}
+		}
+
+		p = b->buf;
+		end = b->buf + b->buflen;
+		while ((nl = memchr(p, '\n', end - p)) != NULL)
+		{
+			*nl = '\0';
+			opensex_batch_add_row(b, p, nl);
+			p = nl + 1;
+		}
+
+		if (b->last)
+		{
+			/* last row without a newline */
+			if (p < end)
+			{
+				*end = '\0';
+				opensex_batch_add_row(b, p, end);
+			}
+
+			opensex_pipe_push(pp, b);
+			break;
+		}
+
+		next = opensex_batch_create((size_t)(end - p) * 2 > OPENSEX_BLOCK ? (size_t)(end - p) * 2 : OPENSEX_BLOCK);
+		memcpy(next->buf, p, end - p);
+		next->buflen = end - p;
+
+		if (!opensex_pipe_push(pp, b))
+		{
+			opensex_batch_destroy(next);
+			break;
+		}
+
+		b = next;
+	}
+
+	return NULL;
+}
+
+static bool opensex_pipe_read_next_row(database_handle_t *hdl)
+{
+	opensex_t *rs = (opensex_t *)hdl->priv;
+	opensex_pipe_t *pp = rs->pipe;
+	opensex_row_t *r;
+
+	while (pp->batch == NULL || pp->row == pp->batch->nrows)
+	{
+		if (pp->batch != NULL)
+		{
+			if (pp->batch->last)
+			{
+				if (pp->batch->error != 0)
+				{
+					slog(LG_ERROR, "opensex-read-next-row: error at %s line %d: %s", hdl->file, hdl->line, strerror(pp->batch->error));
+					slog(LG_ERROR, "opensex-read-next-row: exiting to avoid data loss");
+					exit(EXIT_FAILURE);
+				}
+
+				return false;
+			}
+
+			opensex_batch_destroy(pp->batch);
+		}
+
+		pp->batch = opensex_pipe_pop(pp);
+		pp->row = 0;
+	}
+
+	r = &pp->batch->rows[pp->row++];
+	pp->cell = r->cell;
+	pp->cellend = r->cell + r->ncells;
+
+	hdl->line++;
+	hdl->token = 0;
+	return true;
+}
+
+static opensex_cell_t *opensex_pipe_next_cell(database_handle_t *db)
+{
+	opensex_t *rs = (opensex_t *)db->priv;
+	opensex_pipe_t *pp = rs->pipe;
+	opensex_cell_t *c;
+
+	if (pp->cell == pp->cellend)
+		return NULL;
+
+	c = &pp->batch->cells[pp->cell++];
+	*c->end = '\0';
+
+	db->token++;
+	return c;
+}
+
+static const char *opensex_pipe_read_word(database_handle_t *db)
+{
+	opensex_cell_t *c = opensex_pipe_next_cell(db);
+
+	return c != NULL ? c->start : NULL;
+}
+
+static const char *opensex_pipe_read_str(database_handle_t *db)
+{
+	opensex_t *rs = (opensex_t *)db->priv;
+	opensex_pipe_t *pp = rs->pipe;
+
+	db->token++;
+
+	if (pp->cell == pp->cellend)
+		return NULL;
+
+	return pp->batch->cells[pp->cell].start;
+}
+
+static bool opensex_pipe_read_int(database_handle_t *db, int *res)
+{
+	opensex_cell_t *c = opensex_pipe_next_cell(db);
+
+	if (c == NULL || c->type == OPENSEX_CELL_WORD)
+		return false;
+
+	*res = c->type == OPENSEX_CELL_NEGNUM ? -(int)c->num : (int)c->num;
+	return true;
+}
+
+static bool opensex_pipe_read_uint(database_handle_t *db, unsigned int *res)
+{
+	opensex_cell_t *c = opensex_pipe_next_cell(db);
+
+	if (c == NULL || c->type != OPENSEX_CELL_NUM)
+		return false;
+
+	*res = c->num;
+	return true;
+}
+
+static bool opensex_pipe_read_time(database_handle_t *db, time_t *res)
+{
+	opensex_cell_t *c = opensex_pipe_next_cell(db);
+
+	if (c == NULL || c->type != OPENSEX_CELL_NUM)
+		return false;
+
+	*res = c->num;
+	return true;
+}
+
+static database_vtable_t opensex_pipe_vt = {
+	.name = "opensex",
+
+	.read_next_row = opensex_pipe_read_next_row,
+
+	.read_word = opensex_pipe_read_word,
+	.read_str = opensex_pipe_read_str,
+	.read_int = opensex_pipe_read_int,
+	.read_uint = opensex_pipe_read_uint,
+	.read_time = opensex_pipe_read_time,
+};
+
+static bool opensex_pipe_start(opensex_t *rs)
+{
+	opensex_pipe_t *pp = scalloc(sizeof(opensex_pipe_t), 1);
+
+	pp->stream = &rs->stream;
+	pthread_mutex_init(&pp->lock, NULL);
+	pthread_cond_init(&pp->cond, NULL);
+
+	if (pthread_create(&pp->thread, NULL, opensex_pipe_reader, pp) != 0)
+	{
+		slog(LG_DEBUG, "opensex_pipe_start(): cannot create reader thread, loading without it");
+		pthread_cond_destroy(&pp->cond);
+		pthread_mutex_destroy(&pp->lock);
+		free(pp);
+		return false;
+	}
+
+	rs->pipe = pp;
+	return true;
+}
+
+static void opensex_pipe_stop(opensex_t *rs)
+{
+	opensex_pipe_t *pp = rs->pipe;
+
+	/* the reader thread may still be waiting to queue a batch if the
+	 * database was not read to the end.
+	 */
+	pthread_mutex_lock(&pp->lock);
+	pp->stop = true;
+	pthread_cond_broadcast(&pp->cond);
+	pthread_mutex_unlock(&pp->lock);
+
+	pthread_join(pp->thread, NULL);
+
+	for (; pp->qlen > 0; pp->qlen--, pp->qhead = (pp->qhead + 1) % OPENSEX_QUEUE)
+		opensex_batch_destroy(pp->queue[pp->qhead]);
+
+	if (pp->batch != NULL)
+		opensex_batch_destroy(pp->batch);
+
+	pthread_cond_destroy(&pp->cond);
+	pthread_mutex_destroy(&pp->lock);
+	free(pp);
+	rs->pipe = NULL;
+}
+#endif
+
 static database_handle_t *opensex_db_open_read(const char *filename)
 {
 	database_handle_t *db;
 	opensex_t *rs;
-	FILE *f;
+	int fd;
 	int errno1;
 	char path[BUFSIZE];
 
 	snprintf(path, BUFSIZE, "%s/%s", datadir, filename != NULL ? filename : "services.db");
-	f = fopen(path, "r");
-	if (!f)
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
 	{
 		errno1 = errno;
 
@@ -271,15 +1526,32 @@ static database_handle_t *opensex_db_open_read(const char *filename)
 
 	rs = scalloc(sizeof(opensex_t), 1);
 	rs->grver = 1;
-	rs->buf = scalloc(512, 1);
-	rs->bufsize = 512;
+	rs->buf = smalloc(OPENSEX_BLOCK);
+	rs->bufsize = OPENSEX_BLOCK;
 	rs->token = NULL;
-	rs->f = f;
+	rs->fd = fd;
+	rs->cold.fd = -1;
+
+	/* not being able to read an existing database must not lead to an
+	 * empty one being written over it.
+	 */
+	if (!opensex_stream_open_read(&rs->stream, fd, path))
+	{
+		slog(LG_ERROR, "db-open-read: exiting to avoid data loss");
+		exit(EXIT_FAILURE);
+	}
+
+	/* the cold section is read with pread(), which needs the plain text */
+	rs->lazy = opensex_lazy_load && !db_full_load && rs->stream.type == OPENSEX_PLAIN;
 
 	db = scalloc(sizeof(database_handle_t), 1);
 	db->priv = rs;
 	db->vt = &opensex_vt;
 	db->txn = DB_READ;
+#ifdef HAVE_PTHREAD
+	if (opensex_pipe_start(rs))
+		db->vt = &opensex_pipe_vt;
+#endif
 	db->file = sstrdup(path);
 	db->line = 0;
 	db->token = 0;
@@ -292,7 +1564,6 @@ static database_handle_t *opensex_db_open_write(const char *filename)
 	database_handle_t *db;
 	opensex_t *rs;
 	int fd;
-	FILE *f;
 	int errno1;
 	char bpath[BUFSIZE], path[BUFSIZE];
 
@@ -301,8 +1572,8 @@ static database_handle_t *opensex_db_open_write(const char *filename)
 	mowgli_strlcpy(path, bpath, sizeof path);
 	mowgli_strlcat(path, ".new", sizeof path);
 
-	fd = open(path, O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
-	if (fd < 0 || ! (f = fdopen(fd, "w")))
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+	if (fd < 0)
 	{
 		errno1 = errno;
 		slog(LG_ERROR, "db-open-write: cannot open '%s' for writing: %s", path, strerror(errno1));
@@ -311,8 +1582,38 @@ static database_handle_t *opensex_db_open_write(const char *filename)
 	}
 
 	rs = scalloc(sizeof(opensex_t), 1);
-	rs->f = f;
+	rs->fd = fd;
+	rs->buf = smalloc(OPENSEX_BLOCK);
+	rs->bufsize = OPENSEX_BLOCK;
 	rs->grver = 1;
+	rs->cold.fd = -1;
+
+	if (!opensex_stream_open_write(&rs->stream, fd))
+	{
+		slog(LG_ERROR, "db-open-write: cannot set up compression for '%s'", path);
+		wallops(_("\2DATABASE ERROR\2: db-open-write: cannot set up compression for '%s'"), path);
+		opensex_stream_close(&rs->stream, DB_WRITE);
+		close(fd);
+		free(rs->buf);
+		free(rs);
+		return NULL;
+	}
+
+	if (opensex_lazy_load && rs->stream.type == OPENSEX_PLAIN)
+	{
+		/* the cold section is collected in an unlinked file */
+		mowgli_strlcat(path, ".cold", sizeof path);
+
+		if ((rs->cold.fd = open(path, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) < 0)
+			slog(LG_ERROR, "db-open-write: cannot open '%s', writing an unsectioned database: %s", path, strerror(errno));
+		else
+		{
+			unlink(path);
+			rs->altbuf = smalloc(OPENSEX_BLOCK);
+			rs->altsize = OPENSEX_BLOCK;
+			rs->coldindex = mowgli_string_create();
+		}
+	}
 
 	db = scalloc(sizeof(database_handle_t), 1);
 	db->priv = rs;
@@ -336,13 +1637,14 @@ static database_handle_t *opensex_db_open(const char *filename, database_transac
 	return opensex_db_open_read(filename);
 }
 
-static void opensex_db_close(database_handle_t *db)
+static bool opensex_db_close(database_handle_t *db)
 {
 	opensex_t *rs;
 	int errno1;
+	bool ret = true;
 	char oldpath[BUFSIZE], newpath[BUFSIZE];
 
-	return_if_fail(db != NULL);
+	return_val_if_fail(db != NULL, false);
 	rs = db->priv;
 
 	mowgli_strlcpy(oldpath, db->file, sizeof oldpath);
@@ -350,31 +1652,126 @@ static void opensex_db_close(database_handle_t *db)
 
 	mowgli_strlcpy(newpath, db->file, sizeof newpath);
 
-	fclose(rs->f);
-
 	if (db->txn == DB_WRITE)
 	{
-		/* now, replace the old database with the new one, using an atomic rename */
-		if (srename(oldpath, newpath) < 0)
+		if (rs->cold.fd >= 0)
+		{
+			opensex_write_cold(rs);
+			close(rs->cold.fd);
+			free(rs->altbuf);
+			rs->coldindex->destroy(rs->coldindex);
+		}
+
+		opensex_flush(rs, true);
+
+#if defined(_POSIX_SYNCHRONIZED_IO) && _POSIX_SYNCHRONIZED_IO > 0
+		if (rs->error == 0 && opensex_sync && fdatasync(rs->fd) < 0)
+#else
+		if (rs->error == 0 && opensex_sync && fsync(rs->fd) < 0)
+#endif
+			rs->error = errno;
+
+		if (close(rs->fd) < 0 && rs->error == 0)
+			rs->error = errno;
+
+		if (rs->error != 0)
 		{
-			errno1 = errno;
-			slog(LG_ERROR, "db_save(): cannot rename services.db.new to services.db: %s", strerror(errno1));
-			wallops(_("\2DATABASE ERROR\2: db_save(): cannot rename services.db.new to services.db: %s"), strerror(errno1));
+			slog(LG_ERROR, "db_save(): cannot write to %s: %s", oldpath, strerror(rs->error));
+			wallops(_("\2DATABASE ERROR\2: db_save(): cannot write to %s: %s"), oldpath, strerror(rs->error));
+			ret = false;
 		}
+	}
+	else
+	{
+#ifdef HAVE_PTHREAD
+		if (rs->pipe != NULL)
+			opensex_pipe_stop(rs);
+#endif
+		close(rs->fd);
+	}
 
-		hook_call_db_saved();
+	/* now, replace the old database with the new one, using an atomic rename,
+	 * but only if the new one was written out completely.
+	 */
+	if (db->txn == DB_WRITE && ret && srename(oldpath, newpath) < 0)
+	{
+		errno1 = errno;
+		slog(LG_ERROR, "db_save(): cannot rename services.db.new to services.db: %s", strerror(errno1));
+		wallops(_("\2DATABASE ERROR\2: db_save(): cannot rename services.db.new to services.db: %s"), strerror(errno1));
+		ret = false;
 	}
 
+	opensex_stream_close(&rs->stream, db->txn);
 	free(rs->buf);
 	free(rs);
 	free(db->file);
 	free(db);
+
+	return ret;
+}
+
+/* Loads the cold data of an account from the database services were
+ * started from.
+ */
+static void opensex_db_load_cold(myuser_t *mu, off_t offset, size_t len)
+{
+	database_handle_t db;
+	opensex_t rs;
+	const char *cmd;
+	ssize_t n;
+	size_t done;
+
+	memset(&rs, 0, sizeof rs);
+	rs.fd = -1;
+	rs.cold.fd = -1;
+	rs.eof = true;
+	rs.bufsize = len + 1;
+	rs.buf = smalloc(rs.bufsize);
+
+	for (done = 0; done < len; done += n)
+	{
+		if (opensex_cold_fd < 0)
+		{
+			errno = EBADF;
+			n = -1;
+		}
+		else
+			n = pread(opensex_cold_fd, rs.buf + done, len - done, opensex_cold_base + offset + done);
+
+		if (n < 0 && errno == EINTR)
+			n = 0;
+		else if (n <= 0)
+		{
+			/* the account would be saved without its data */
+			slog(LG_ERROR, "opensex_db_load_cold(): cannot read the data of %s from %s: %s", entity(mu)->name,
+					opensex_cold_path != NULL ? opensex_cold_path : "the database", n < 0 ? strerror(errno) : "unexpected end of file");
+			slog(LG_ERROR, "opensex_db_load_cold(): exiting to avoid data loss");
+			exit(EXIT_FAILURE);
+		}
+	}
+	rs.buflen = len;
+
+	memset(&db, 0, sizeof db);
+	db.priv = &rs;
+	db.vt = &opensex_vt;
+	db.txn = DB_READ;
+	db.file = opensex_cold_path;
+
+	while (db_read_next_row(&db))
+	{
+		cmd = db_read_word(&db);
+		if (!cmd || !*cmd || strchr("#\n\t \r", *cmd)) continue;
+		db_process(&db, cmd);
+	}
+
+	free(rs.buf);
 }
 
 static database_module_t opensex_mod = {
 	.db_open = opensex_db_open,
 	.db_close = opensex_db_close,
 	.db_parse = opensex_db_parse,
+	.db_load_cold = opensex_db_load_cold,
 };
 
 void _modinit(module_t *m)
@@ -386,6 +1783,12 @@ void _modinit(module_t *m)
 	db_mod = &opensex_mod;
 
 	db_register_type_handler("GRVER", opensex_h_grver);
+	db_register_type_handler("MUC", opensex_h_muc);
+	db_register_type_handler("SECTION", opensex_h_section);
+
+	add_bool_conf_item("SYNC", &conf_db_table, 0, &opensex_sync, false);
+	add_dupstr_conf_item("COMPRESSION", &conf_db_table, 0, &opensex_compression, NULL);
+	add_bool_conf_item("LAZY_LOAD", &conf_db_table, 0, &opensex_lazy_load, false);
 
 	backend_loaded = true;
 }
@@ -256,13 +256,10 @@ static void chanfix_clear_bans(channel_t *ch)
 		}
 		channel_mode_va(chanfix->me, ch, 2, "-k", "*");
 	}
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, ch->bans.head)
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, chanban_first(ch, 'b'))
 	{
 		chanban_t *cb = n->data;
 
-		if (cb->type != 'b')
-			continue;
-
 		if (!joined)
 		{
 			joined = true;
@@ -105,12 +105,9 @@ static void clear_bans_matching_entity(mychan_t *mc, myentity_t *mt)
 		user_t *tu;
 		mowgli_node_t *it, *itn;
 
-		char hostbuf2[BUFSIZE];
-
 		tu = n->data;
 
-		snprintf(hostbuf2, BUFSIZE, "%s!%s@%s", tu->nick, tu->user, tu->vhost);
-		for (it = next_matching_ban(mc->chan, tu, 'b', mc->chan->bans.head); it != NULL; it = next_matching_ban(mc->chan, tu, 'b', itn))
+		for (it = next_matching_ban(mc->chan, tu, 'b', chanban_first(mc->chan, 'b')); it != NULL; it = next_matching_ban(mc->chan, tu, 'b', itn))
 		{
 			chanban_t *cb;
 
@@ -472,7 +472,7 @@ static void cs_join(hook_channel_joinpart_t *hdata)
 	if (mc->mlock_on & CMODE_INVITE && !(flags & CA_INVITE) &&
 			(!me.bursting || mc->flags & MC_RECREATED) &&
 			(!(u->server->flags & SF_EOB) || (chan->nummembers - chan->numsvcmembers == 1)) &&
-			(!ircd->invex_mchar || !next_matching_ban(chan, u, ircd->invex_mchar, chan->bans.head)))
+			(!ircd->invex_mchar || !next_matching_ban(chan, u, ircd->invex_mchar, chanban_first(chan, ircd->invex_mchar))))
 	{
 		if (chan->nummembers - chan->numsvcmembers == 1)
 		{
@@ -224,6 +224,7 @@ static void notify_victims(sourceinfo_t *si, channel_t *c, chanban_t *cb, int di
 	 * strip it from those who do so we can reliably match users */
 	memcpy(&tmpban, cb, sizeof(chanban_t));
 	tmpban.mask = strip_extban(cb->mask);
+	tmpban.matcher = hostmatch_create(tmpban.mask);
 
 	/* only check the newly added/removed quiet */
 	mowgli_node_add(&tmpban, &ban_n, &ban_l);
@@ -260,6 +261,7 @@ static void notify_victims(sourceinfo_t *si, channel_t *c, chanban_t *cb, int di
 		for (i = 0; i < to_notify_count; i++)
 			notify_one_victim(si, c, to_notify[i], dir);
 
+	hostmatch_destroy(tmpban.matcher);
 	free(tmpban.mask);
 }
 
@@ -421,7 +423,7 @@ static void cs_cmd_unquiet(sourceinfo_t *si, int parc, char *parv[])
 			int count = 0;
 
 			make_extban(hostbuf2, sizeof hostbuf2, tu);
-			for (n = next_matching_ban(c, tu, banlike_char, c->bans.head); n != NULL; n = next_matching_ban(c, tu, banlike_char, tn))
+			for (n = next_matching_ban(c, tu, banlike_char, chanban_first(c, banlike_char)); n != NULL; n = next_matching_ban(c, tu, banlike_char, tn))
 			{
 				tn = n->next;
 				cb = n->data;
@@ -164,7 +164,7 @@ static void cs_cmd_recover(sourceinfo_t *si, int parc, char *parv[])
 		/* unban the user */
 		snprintf(hostbuf2, BUFSIZE, "%s!%s@%s", si->su->nick, si->su->user, si->su->vhost);
 
-		for (n = next_matching_ban(mc->chan, si->su, 'b', mc->chan->bans.head); n != NULL; n = next_matching_ban(mc->chan, si->su, 'b', tn))
+		for (n = next_matching_ban(mc->chan, si->su, 'b', chanban_first(mc->chan, 'b')); n != NULL; n = next_matching_ban(mc->chan, si->su, 'b', tn))
 		{
 			tn = n->next;
 			cb = n->data;
@@ -34,8 +34,8 @@ void cs_cmd_taxonomy(sourceinfo_t *si, int parc, char *parv[])
 {
 	char *target = parv[0];
 	mychan_t *mc;
-	mowgli_patricia_iteration_state_t state;
 	metadata_t *md;
+	unsigned int mdi;
 	bool isoper;
 
 	if (!target || *target != '#')
@@ -67,7 +67,7 @@ void cs_cmd_taxonomy(sourceinfo_t *si, int parc, char *parv[])
 		logcommand(si, CMDLOG_GET, "TAXONOMY: \2%s\2", mc->name);
 	command_success_nodata(si, _("Taxonomy for \2%s\2:"), target);
 
-	MOWGLI_PATRICIA_FOREACH(md, &state, object(mc)->metadata)
+	METADATA_FOREACH(md, mdi, mc)
 	{
                 if (!strncmp(md->name, "private:", 8) && !isoper)
                         continue;
@@ -91,16 +91,14 @@ static void cs_cmd_unban(sourceinfo_t *si, int parc, char *parv[])
 	tu = si->su;
 	{
 		mowgli_node_t *n, *tn;
-		char hostbuf2[BUFSIZE];
 		int count = 0;
 
-		snprintf(hostbuf2, BUFSIZE, "%s!%s@%s", tu->nick, tu->user, tu->vhost);
-		for (n = next_matching_ban(c, tu, 'b', c->bans.head); n != NULL; n = next_matching_ban(c, tu, 'b', tn))
+		for (n = next_matching_ban(c, tu, 'b', chanban_first(c, 'b')); n != NULL; n = next_matching_ban(c, tu, 'b', tn))
 		{
 			tn = n->next;
 			cb = n->data;
 
-			logcommand(si, CMDLOG_DO, "UNBAN: \2%s\2 \2%s\2 (for user \2%s\2)", mc->name, cb->mask, hostbuf2);
+			logcommand(si, CMDLOG_DO, "UNBAN: \2%s\2 \2%s\2 (for user \2%s\2)", mc->name, cb->mask, user_masks(tu)->vhost);
 			modestack_mode_param(chansvs.nick, c, MTYPE_DEL, cb->type, cb->mask);
 			chanban_delete(cb);
 			count++;
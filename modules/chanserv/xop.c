@@ -371,6 +371,7 @@ static void cs_xop_do_del(sourceinfo_t *si, mychan_t *mc, myentity_t *mt, char *
 		req.oldlevel = ca->level;
 
 		ca->level = 0;
+		chanacs_cache_invalidate_channel(mc);
 
 		req.newlevel = ca->level;
 
@@ -393,6 +394,7 @@ static void cs_xop_do_del(sourceinfo_t *si, mychan_t *mc, myentity_t *mt, char *
 	req.oldlevel = ca->level;
 
 	ca->level = 0;
+	chanacs_cache_invalidate_channel(mc);
 
 	req.newlevel = ca->level;
 
@@ -111,6 +111,7 @@ mygroup_t *mygroup_find(const char *name)
 
 static void groupacs_des(groupacs_t *ga)
 {
+	chanacs_cache_invalidate_all();
 	metadata_delete_all(ga);
 	mowgli_heap_free(groupacs_heap, ga);
 }
@@ -131,6 +132,7 @@ groupacs_t *groupacs_add(mygroup_t *mg, myentity_t *mt, unsigned int flags)
 
 	mowgli_node_add(ga, &ga->gnode, &mg->acs);
 	mowgli_node_add(ga, &ga->unode, myentity_get_membership_list(mt));
+	chanacs_cache_invalidate_all();
 
 	return ga;
 }
@@ -107,6 +107,8 @@ static void ms_cmd_forward(sourceinfo_t *si, int parc, char *parv[])
 		return;
 	}
 
+	myuser_load_cold(tmu);
+
 	/* Check to make sure target inbox not full */
 	if (tmu->memos.count >= me.mdlimit)
 	{
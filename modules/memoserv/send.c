@@ -119,6 +119,8 @@ static void ms_cmd_send(sourceinfo_t *si, int parc, char *parv[])
 			return;
 		}
 
+		myuser_load_cold(tmu);
+
 		/* Check to make sure target inbox not full */
 		if (tmu->memos.count >= *maxmemos)
 		{
@@ -117,6 +117,8 @@ static void ms_cmd_sendgroup(sourceinfo_t *si, int parc, char *parv[])
 		if (tmu->flags & MU_NOMEMO)
 			continue;
 
+		myuser_load_cold(tmu);
+
 		/* Check to make sure target inbox not full */
 		if (tmu->memos.count >= *maxmemos)
 			continue;
@@ -239,6 +239,8 @@ static void ns_cmd_access(sourceinfo_t *si, int parc, char *parv[])
 
 		command_success_nodata(si, _("Access list for \2%s\2:"), entity(mu)->name);
 
+		myuser_load_cold(mu);
+
 		MOWGLI_ITER_FOREACH(n, mu->access_list.head)
 		{
 			mask = n->data;
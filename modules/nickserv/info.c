@@ -42,8 +42,8 @@ static void ns_cmd_info(sourceinfo_t *si, int parc, char *parv[])
 	time_t registered;
 	struct tm tm, tm2;
 	metadata_t *md;
+	unsigned int mdi;
 	mowgli_node_t *n;
-	mowgli_patricia_iteration_state_t state;
 	const char *vhost;
 	const char *vhost_timestring;
 	const char *vhost_assigner;
@@ -292,7 +292,8 @@ static void ns_cmd_info(sourceinfo_t *si, int parc, char *parv[])
 		command_success_nodata(si, _("Email      : %s%s"), mu->email,
 					(mu->flags & MU_HIDEMAIL) ? " (hidden)": "");
 
-	MOWGLI_PATRICIA_FOREACH(md, &state, object(mu)->metadata)
+	myuser_load_cold(mu);
+	METADATA_FOREACH(md, mdi, mu)
 	{
 		if (!strncmp(md->name, "private:", 8))
 			continue;
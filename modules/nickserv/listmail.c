@@ -37,20 +37,23 @@ struct listmail_state
 	int matches;
 };
 
+static void listmail_found(struct listmail_state *state, myuser_t *mu)
+{
+	/* in the future we could add a LIMIT parameter */
+	if (state->matches == 0)
+		command_success_nodata(state->origin, "Accounts matching e-mail address \2%s\2:", state->pattern);
+
+	command_success_nodata(state->origin, "- %s (%s)", entity(mu)->name, mu->email);
+	state->matches++;
+}
+
 static int listmail_foreach_cb(myentity_t *mt, void *privdata)
 {
 	struct listmail_state *state = (struct listmail_state *) privdata;
 	myuser_t *mu = user(mt);
 
 	if (state->email_canonical == mu->email_canonical || !match(state->pattern, mu->email))
-	{
-		/* in the future we could add a LIMIT parameter */
-		if (state->matches == 0)
-			command_success_nodata(state->origin, "Accounts matching e-mail address \2%s\2:", state->pattern);
-
-		command_success_nodata(state->origin, "- %s (%s)", entity(mu)->name, mu->email);
-		state->matches++;
-	}
+		listmail_found(state, mu);
 
 	return 0;
 }
@@ -59,6 +62,8 @@ static void ns_cmd_listmail(sourceinfo_t *si, int parc, char *parv[])
 {
 	char *email = parv[0];
 	struct listmail_state state;
+	mowgli_list_t *l;
+	mowgli_node_t *n;
 
 	if (!email)
 	{
@@ -69,10 +74,26 @@ static void ns_cmd_listmail(sourceinfo_t *si, int parc, char *parv[])
 
 	state.matches = 0;
 	state.pattern = email;
-	state.email_canonical = canonicalize_email(email);
 	state.origin = si;
-	myentity_foreach_t(ENT_USER, listmail_foreach_cb, &state);
-	strshare_unref(state.email_canonical);
+
+	/* without any of match()'s wildcard characters, everything that
+	 * matches has the same canonical email, so the index has all of
+	 * the matches.
+	 */
+	if (strpbrk(email, "*?&#%\\") == NULL)
+	{
+		if ((l = myuser_find_email(email)) != NULL)
+		{
+			MOWGLI_ITER_FOREACH(n, l->head)
+				listmail_found(&state, n->data);
+		}
+	}
+	else
+	{
+		state.email_canonical = canonicalize_email(email);
+		myentity_foreach_t(ENT_USER, listmail_foreach_cb, &state);
+		strshare_unref(state.email_canonical);
+	}
 
 	logcommand(si, CMDLOG_ADMIN, "LISTMAIL: \2%s\2 (\2%d\2 matches)", email, state.matches);
 	if (state.matches == 0)
@@ -31,8 +31,8 @@ void _moddeinit(module_unload_intent_t intent)
 
 static void ns_cmd_listownmail(sourceinfo_t *si, int parc, char *parv[])
 {
-	myentity_t *mt;
-	myentity_iteration_state_t state;
+	mowgli_list_t *l;
+	mowgli_node_t *n;
 	unsigned int matches = 0;
 
 	if (si->smu->flags & MU_WAITAUTH)
@@ -54,9 +54,12 @@ static void ns_cmd_listownmail(sourceinfo_t *si, int parc, char *parv[])
 
 	command_add_flood(si, FLOOD_HEAVY);
 
-	MYENTITY_FOREACH_T(mt, &state, ENT_USER)
+	/* accounts with the same address have the same canonical one */
+	l = myuser_find_email(si->smu->email);
+
+	MOWGLI_ITER_FOREACH(n, l != NULL ? l->head : NULL)
 	{
-		myuser_t *mu = user(mt);
+		myuser_t *mu = n->data;
 
 		continue_if_fail(mu != NULL);
 
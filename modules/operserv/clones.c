@@ -80,6 +80,38 @@ static inline bool cexempt_expired(cexcept_t *c)
 	return false;
 }
 
+/* Exemptions are also kept in a radix tree by network, see find_exempt().
+ * Where several have the same network, the first one is in the tree.
+ */
+static cidrtree_t *clone_exempt_tree;
+
+static void cexempt_index(cexcept_t *c)
+{
+	if (cidrtree_find(clone_exempt_tree, c->ip) == NULL)
+		cidrtree_add(clone_exempt_tree, c->ip, c);
+}
+
+static void cexempt_destroy(cexcept_t *c)
+{
+	mowgli_node_t *n;
+
+	if (cidrtree_find(clone_exempt_tree, c->ip) == c)
+	{
+		cidrtree_delete(clone_exempt_tree, c->ip);
+
+		/* let another exemption for this network take its place */
+		MOWGLI_ITER_FOREACH(n, clone_exempts.head)
+		{
+			if (n->data != c)
+				cexempt_index(n->data);
+		}
+	}
+
+	free(c->ip);
+	free(c->reason);
+	free(c);
+}
+
 command_t os_clones = { "CLONES", N_("Manages network wide clones."), PRIV_AKILL, 5, os_cmd_clones, { .path = "oservice/clones" } };
 
 command_t os_clones_kline = { "KLINE", N_("Enables/disables klines for excessive clones."), AC_NONE, 1, os_cmd_clones_kline, { .path = "" } };
@@ -136,6 +168,7 @@ void _modinit(module_t *m)
 	db_register_type_handler("CLONES-EX", db_h_ex);
 
 	hostlist = mowgli_patricia_create(noopcanon);
+	clone_exempt_tree = cidrtree_create();
 	hostentry_heap = mowgli_heap_create(sizeof(hostentry_t), HEAP_USER, BH_NOW);
 
 	kline_duration = 3600; /* set a default */
@@ -183,6 +216,8 @@ void _moddeinit(module_unload_intent_t intent)
 		mowgli_node_free(n);
 	}
 
+	cidrtree_destroy(clone_exempt_tree);
+
 	service_named_unbind_command("operserv", &os_clones);
 
 	command_delete(&os_clones_kline, os_clones_cmds);
@@ -230,9 +265,7 @@ static void write_exemptdb(database_handle_t *db)
 		cexcept_t *c = n->data;
 		if (cexempt_expired(c))
 		{
-			free(c->ip);
-			free(c->reason);
-			free(c);
+			cexempt_destroy(c);
 			mowgli_node_delete(n, &clone_exempts);
 			mowgli_node_free(n);
 		}
@@ -299,31 +332,13 @@ static void db_h_ex(database_handle_t *db, const char *type)
 	c->expires = expires;
 	c->reason = sstrdup(reason);
 	mowgli_node_add(c, mowgli_node_create(), &clone_exempts);
+	cexempt_index(c);
 }
 
 static cexcept_t * find_exempt(const char *ip)
 {
-	mowgli_node_t *n;
-
-	/* first check for an exact match */
-	MOWGLI_ITER_FOREACH(n, clone_exempts.head)
-	{
-		cexcept_t *c = n->data;
-
-		if (!strcmp(ip, c->ip))
-			return c;
-	}
-
-	/* then look for cidr */
-	MOWGLI_ITER_FOREACH(n, clone_exempts.head)
-	{
-		cexcept_t *c = n->data;
-
-		if (!match_ips(c->ip, ip))
-			return c;
-	}
-
-	return 0;
+	/* the most specific exemption covering the address */
+	return cidrtree_search(clone_exempt_tree, ip);
 }
 
 static void os_cmd_clones(sourceinfo_t *si, int parc, char *parv[])
@@ -554,6 +569,7 @@ static void os_cmd_clones_addexempt(sourceinfo_t *si, int parc, char *parv[])
 		c->ip = sstrdup(ip);
 		c->reason = sstrdup(rreason);
 		mowgli_node_add(c, mowgli_node_create(), &clone_exempts);
+		cexempt_index(c);
 		command_success_nodata(si, _("Added \2%s\2 to clone exempt list."), ip);
 	}
 	else
@@ -592,17 +608,13 @@ static void os_cmd_clones_delexempt(sourceinfo_t *si, int parc, char *parv[])
 
 		if (cexempt_expired(c))
 		{
-			free(c->ip);
-			free(c->reason);
-			free(c);
+			cexempt_destroy(c);
 			mowgli_node_delete(n, &clone_exempts);
 			mowgli_node_free(n);
 		}
 		else if (!strcmp(c->ip, arg))
 		{
-			free(c->ip);
-			free(c->reason);
-			free(c);
+			cexempt_destroy(c);
 			mowgli_node_delete(n, &clone_exempts);
 			mowgli_node_free(n);
 			command_success_nodata(si, _("Removed \2%s\2 from clone exempt list."), arg);
@@ -673,9 +685,7 @@ static void os_cmd_clones_setexempt(sourceinfo_t *si, int parc, char *parv[])
 
 			if (cexempt_expired(c))
 			{
-				free(c->ip);
-				free(c->reason);
-				free(c);
+				cexempt_destroy(c);
 				mowgli_node_delete(n, &clone_exempts);
 				mowgli_node_free(n);
 			}
@@ -822,9 +832,7 @@ static void os_cmd_clones_listexempt(sourceinfo_t *si, int parc, char *parv[])
 
 		if (cexempt_expired(c))
 		{
-			free(c->ip);
-			free(c->reason);
-			free(c);
+			cexempt_destroy(c);
 			mowgli_node_delete(n, &clone_exempts);
 			mowgli_node_free(n);
 		}
@@ -516,7 +516,7 @@ static void os_cmd_rwatch_set(sourceinfo_t *si, int parc, char *parv[])
 static void rwatch_newuser(hook_user_nick_t *data)
 {
 	user_t *u = data->u;
-	char usermask[NICKLEN+USERLEN+HOSTLEN+GECOSLEN];
+	const char *usermask;
 	mowgli_node_t *n;
 	rwatch_t *rw;
 
@@ -527,7 +527,7 @@ static void rwatch_newuser(hook_user_nick_t *data)
 	if (is_internal_client(u))
 		return;
 
-	snprintf(usermask, sizeof usermask, "%s!%s@%s %s", u->nick, u->user, u->host, u->gecos);
+	usermask = user_masks(u)->gecos;
 
 	MOWGLI_ITER_FOREACH(n, rwatch_list.head)
 	{
@@ -580,7 +580,7 @@ static void rwatch_newuser(hook_user_nick_t *data)
 static void rwatch_nickchange(hook_user_nick_t *data)
 {
 	user_t *u = data->u;
-	char usermask[NICKLEN+USERLEN+HOSTLEN+GECOSLEN];
+	const char *usermask;
 	char oldusermask[NICKLEN+USERLEN+HOSTLEN+GECOSLEN];
 	mowgli_node_t *n;
 	rwatch_t *rw;
@@ -592,7 +592,7 @@ static void rwatch_nickchange(hook_user_nick_t *data)
 	if (is_internal_client(u))
 		return;
 
-	snprintf(usermask, sizeof usermask, "%s!%s@%s %s", u->nick, u->user, u->host, u->gecos);
+	usermask = user_masks(u)->gecos;
 	snprintf(oldusermask, sizeof oldusermask, "%s!%s@%s %s", data->oldnick, u->user, u->host, u->gecos);
 
 	MOWGLI_ITER_FOREACH(n, rwatch_list.head)
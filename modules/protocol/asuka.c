@@ -177,6 +177,7 @@ static void m_nick(sourceinfo_t *si, int parc, char *parv[])
 				{
 					strshare_unref(u->vhost);
 					u->vhost = strshare_get(parv[5 + i]);
+					user_mask_changed(u);
 				}
 				else
 				{
@@ -184,6 +185,7 @@ static void m_nick(sourceinfo_t *si, int parc, char *parv[])
 
 					strshare_unref(u->vhost);
 					u->vhost = strshare_get(p + 1);
+					user_mask_changed(u);
 
 					mowgli_strlcpy(userbuf, parv[5+i], sizeof userbuf);
 					p = strchr(userbuf, '@');
@@ -192,6 +194,7 @@ static void m_nick(sourceinfo_t *si, int parc, char *parv[])
 
 					strshare_unref(u->user);
 					u->user = strshare_get(userbuf);
+					user_mask_changed(u);
 				}
 				i++;
 			}
@@ -262,6 +265,7 @@ static void m_mode(sourceinfo_t *si, int parc, char *parv[])
 				{
 					strshare_unref(u->vhost);
 					u->vhost = strshare_get(parv[2]);
+					user_mask_changed(u);
 				}
 				else
 				{
@@ -269,6 +273,7 @@ static void m_mode(sourceinfo_t *si, int parc, char *parv[])
 
 					strshare_unref(u->vhost);
 					u->vhost = strshare_get(p + 1);
+					user_mask_changed(u);
 
 					mowgli_strlcpy(userbuf, parv[2], sizeof userbuf);
 
@@ -278,6 +283,7 @@ static void m_mode(sourceinfo_t *si, int parc, char *parv[])
 
 					strshare_unref(u->user);
 					u->user = strshare_get(userbuf);
+					user_mask_changed(u);
 				}
 				slog(LG_DEBUG, "m_mode(): user %s setting vhost %s@%s", u->nick, u->user, u->vhost);
 			}
@@ -289,6 +295,7 @@ static void m_mode(sourceinfo_t *si, int parc, char *parv[])
 
 				strshare_unref(u->vhost);
 				u->vhost = strshare_get(u->host);
+				user_mask_changed(u);
 
 				/* revert to +x vhost if applicable */
 				check_hidehost(u);
@@ -325,6 +332,7 @@ static void check_hidehost(user_t *u)
 
 	strshare_unref(u->vhost);
 	u->vhost = strshare_get(buf);
+	user_mask_changed(u);
 
 	slog(LG_DEBUG, "check_hidehost(): %s -> %s", u->nick, u->vhost);
 }
@@ -178,19 +178,14 @@ static mowgli_node_t *charybdis_next_matching_ban(channel_t *c, user_t *u, int t
 {
 	chanban_t *cb;
 	mowgli_node_t *n;
-	char hostbuf[NICKLEN+USERLEN+HOSTLEN];
-	char realbuf[NICKLEN+USERLEN+HOSTLEN];
-	char ipbuf[NICKLEN+USERLEN+HOSTLEN];
+	const usermasks_t *um;
 	char strippedmask[NICKLEN+USERLEN+HOSTLEN+CHANNELLEN+2];
 	char *p;
 	bool negate, matched;
 	int exttype;
 	channel_t *target_c;
 
-	snprintf(hostbuf, sizeof hostbuf, "%s!%s@%s", u->nick, u->user, u->vhost);
-	snprintf(realbuf, sizeof realbuf, "%s!%s@%s", u->nick, u->user, u->host);
-	/* will be nick!user@ if ip unknown, doesn't matter */
-	snprintf(ipbuf, sizeof ipbuf, "%s!%s@%s", u->nick, u->user, u->ip);
+	um = user_masks(u);
 
 	MOWGLI_ITER_FOREACH(n, first)
 	{
@@ -211,7 +206,7 @@ static mowgli_node_t *charybdis_next_matching_ban(channel_t *c, user_t *u, int t
 		if (p != NULL && p != strippedmask)
 			*p = 0;
 
-		if ((!match(strippedmask, hostbuf) || !match(strippedmask, realbuf) || !match(strippedmask, ipbuf) || !match_cidr(strippedmask, ipbuf)))
+		if ((!match(strippedmask, um->vhost) || !match(strippedmask, um->host) || !match(strippedmask, um->ip) || !match_cidr(strippedmask, um->ip)))
 			return n;
 		if (strippedmask[0] == '$')
 		{
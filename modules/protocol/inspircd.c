@@ -120,15 +120,10 @@ static mowgli_node_t *inspircd_next_matching_ban(channel_t *c, user_t *u, int ty
 {
 	chanban_t *cb;
 	mowgli_node_t *n;
-	char hostbuf[NICKLEN+USERLEN+HOSTLEN];
-	char realbuf[NICKLEN+USERLEN+HOSTLEN];
-	char ipbuf[NICKLEN+USERLEN+HOSTLEN];
+	const usermasks_t *um;
 	char *p;
 
-	snprintf(hostbuf, sizeof hostbuf, "%s!%s@%s", u->nick, u->user, u->vhost);
-	snprintf(realbuf, sizeof realbuf, "%s!%s@%s", u->nick, u->user, u->host);
-	/* will be nick!user@ if ip unknown, doesn't matter */
-	snprintf(ipbuf, sizeof ipbuf, "%s!%s@%s", u->nick, u->user, u->ip);
+	um = user_masks(u);
 
 	MOWGLI_ITER_FOREACH(n, first)
 	{
@@ -139,7 +134,7 @@ static mowgli_node_t *inspircd_next_matching_ban(channel_t *c, user_t *u, int ty
 		if (cb->type != type)
 			continue;
 
-		if ((!match(cb->mask, hostbuf) || !match(cb->mask, realbuf) || !match(cb->mask, ipbuf)) || !match_cidr(cb->mask, ipbuf))
+		if ((!hostmatch(cb->matcher, um->vhost) || !hostmatch(cb->matcher, um->host) || !hostmatch(cb->matcher, um->ip)) || !hostmatch_cidr(cb->matcher, um->ip))
 			return n;
 
 		if (cb->mask[1] == ':' && strchr("MRUjrm", cb->mask[0]))
@@ -173,7 +168,7 @@ static mowgli_node_t *inspircd_next_matching_ban(channel_t *c, user_t *u, int ty
 				matched = !match(p, u->gecos);
 				break;
 			case 'm':
-				matched = (!match(p, hostbuf) || !match(p, realbuf) || !match(p, ipbuf)) || !match_cidr(p, ipbuf);
+				matched = (!match(p, um->vhost) || !match(p, um->host) || !match(p, um->ip)) || !match_cidr(p, um->ip);
 				break;
 			default:
 				continue;
@@ -1108,6 +1103,7 @@ static void inspircd_user_mode(user_t *u, const char *modes)
 					{
 						strshare_unref(u->chost);
 						u->chost = strshare_get(u->vhost);
+						user_mask_changed(u);
 					}
 				}
 				break;
@@ -1329,12 +1325,14 @@ static void m_fident(sourceinfo_t *si, int parc, char *parv[])
 {
 	strshare_unref(si->su->user);
 	si->su->user = strshare_get(parv[0]);
+	user_mask_changed(si->su);
 }
 
 static void m_fhost(sourceinfo_t *si, int parc, char *parv[])
 {
 	strshare_unref(si->su->vhost);
 	si->su->vhost = strshare_get(parv[0]);
+	user_mask_changed(si->su);
 }
 
 static void m_encap(sourceinfo_t *si, int parc, char *parv[])
@@ -176,6 +176,7 @@ static bool nefarious_on_logout(user_t *u, const char *account)
 
 		strshare_unref(u->vhost);
 		u->vhost = strshare_get(u->host);
+		user_mask_changed(u);
 	}
 
 	return false;
@@ -395,6 +396,7 @@ static void m_nick(sourceinfo_t *si, int parc, char *parv[])
 				{
 					strshare_unref(u->vhost);
 					u->vhost = strshare_get(parv[5 + i]);
+					user_mask_changed(u);
 				}
 				else
 				{
@@ -402,6 +404,7 @@ static void m_nick(sourceinfo_t *si, int parc, char *parv[])
 
 					strshare_unref(u->vhost);
 					u->vhost = strshare_get(p + 1);
+					user_mask_changed(u);
 
 					mowgli_strlcpy(userbuf, parv[5+i], sizeof userbuf);
 
@@ -411,6 +414,7 @@ static void m_nick(sourceinfo_t *si, int parc, char *parv[])
 
 					strshare_unref(u->user);
 					u->user = strshare_get(userbuf);
+					user_mask_changed(u);
 				}
 				i++;
 			}
@@ -418,6 +422,7 @@ static void m_nick(sourceinfo_t *si, int parc, char *parv[])
 			{
 				strshare_unref(u->vhost);
 				u->vhost = strshare_get(parv[5 + i]);
+				user_mask_changed(u);
 
 				i++;
 			}
@@ -488,6 +493,7 @@ static void m_mode(sourceinfo_t *si, int parc, char *parv[])
 				{
 					strshare_unref(u->vhost);
 					u->vhost = strshare_get(parv[2]);
+					user_mask_changed(u);
 				}
 				else
 				{
@@ -495,6 +501,7 @@ static void m_mode(sourceinfo_t *si, int parc, char *parv[])
 
 					strshare_unref(u->vhost);
 					u->vhost = strshare_get(p + 1);
+					user_mask_changed(u);
 
 					mowgli_strlcpy(userbuf, parv[2], sizeof userbuf);
 					p = strchr(userbuf, '@');
@@ -503,6 +510,7 @@ static void m_mode(sourceinfo_t *si, int parc, char *parv[])
 
 					strshare_unref(u->user);
 					u->user = strshare_get(userbuf);
+					user_mask_changed(u);
 				}
 				slog(LG_DEBUG, "m_mode(): user %s setting vhost %s@%s", u->nick, u->user, u->vhost);
 			}
@@ -514,6 +522,7 @@ static void m_mode(sourceinfo_t *si, int parc, char *parv[])
 
 				strshare_unref(u->vhost);
 				u->vhost = strshare_get(u->host);
+				user_mask_changed(u);
 
 				/* revert to +x vhost if applicable */
 				check_hidehost(u);
@@ -543,19 +552,13 @@ static void m_clearmode(sourceinfo_t *si, int parc, char *parv[])
 	{
 		if (c == 'b')
 		{
-			MOWGLI_ITER_FOREACH_SAFE(n, tn, chan->bans.head)
-			{
-				if (((chanban_t *)n->data)->type == 'b')
-					chanban_delete(n->data);
-			}
+			MOWGLI_ITER_FOREACH_SAFE(n, tn, chanban_first(chan, 'b'))
+				chanban_delete(n->data);
 		}
 		else if (c == 'e')
 		{
-			MOWGLI_ITER_FOREACH_SAFE(n, tn, chan->bans.head)
-			{
-				if (((chanban_t *)n->data)->type == 'e')
-					chanban_delete(n->data);
-			}
+			MOWGLI_ITER_FOREACH_SAFE(n, tn, chanban_first(chan, 'e'))
+				chanban_delete(n->data);
 		}
 		else if (c == 'k')
 		{
@@ -687,6 +690,7 @@ static void check_hidehost(user_t *u)
 
 	strshare_unref(u->vhost);
 	u->vhost = strshare_get(buf);
+	user_mask_changed(u);
 
 	slog(LG_DEBUG, "check_hidehost(): %s -> %s", u->nick, u->vhost);
 }
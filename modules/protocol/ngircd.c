@@ -327,6 +327,7 @@ static void ngircd_sethost_sts(user_t *source, user_t *target, const char *host)
 		{
 			strshare_unref(target->chost);
 			target->chost = strshare_get(host);
+			user_mask_changed(target);
 		}
 	}
 	else
@@ -336,6 +337,7 @@ static void ngircd_sethost_sts(user_t *source, user_t *target, const char *host)
 
 		strshare_unref(target->chost);
 		target->chost = strshare_get(target->host);
+		user_mask_changed(target);
 	}
 }
 
@@ -588,12 +590,14 @@ static void ngircd_user_mode(user_t *u, const char *modes)
 					{
 						strshare_unref(u->vhost);
 						u->vhost = strshare_get(u->chost);
+						user_mask_changed(u);
 					}
 				}
 				else if (dir == MTYPE_DEL)
 				{
 					strshare_unref(u->vhost);
 					u->vhost = strshare_get(u->host);
+					user_mask_changed(u);
 				}
 				slog(LG_DEBUG, "user got vhost='%s' chost='%s'", u->vhost, u->chost);
 				break;
@@ -823,6 +827,7 @@ static void m_metadata(sourceinfo_t *si, int parc, char *parv[])
 	{
 		strshare_unref(u->chost);
 		u->chost = strshare_get(parv[2]);
+		user_mask_changed(u);
 	}
 }
 
@@ -972,6 +972,7 @@ static void check_hidehost(user_t *u)
 
 	strshare_unref(u->vhost);
 	u->vhost = strshare_get(buf);
+	user_mask_changed(u);
 
 	slog(LG_DEBUG, "check_hidehost(): %s -> %s", u->nick, u->vhost);
 }
@@ -1273,6 +1273,7 @@ static void m_encap(sourceinfo_t *si, int parc, char *parv[])
 
 		strshare_unref(u->host);
 		u->host = strshare_get(parv[2]);
+		user_mask_changed(u);
 	}
 	else if (!irccasecmp(parv[1], "CHGHOST"))
 	{
@@ -1284,6 +1285,7 @@ static void m_encap(sourceinfo_t *si, int parc, char *parv[])
 
 		strshare_unref(u->vhost);
 		u->vhost = strshare_get(parv[3]);
+		user_mask_changed(u);
 
 		slog(LG_DEBUG, "m_encap(): chghost %s -> %s", u->nick,
 				u->vhost);
@@ -1350,10 +1352,12 @@ static void m_signon(sourceinfo_t *si, int parc, char *parv[])
 	/* USER */
 	strshare_unref(u->user);
 	u->user = strshare_get(parv[1]);
+	user_mask_changed(u);
 
 	/* HOST */
 	strshare_unref(u->vhost);
 	u->vhost = strshare_get(parv[2]);
+	user_mask_changed(u);
 
 	/* LOGIN */
 	if(*parv[4] == '*') /* explicitly unchanged */
@@ -1418,6 +1422,7 @@ static void m_chghost(sourceinfo_t *si, int parc, char *parv[])
 
 	strshare_unref(u->vhost);
 	u->vhost = strshare_get(parv[1]);
+	user_mask_changed(u);
 }
 
 static void m_motd(sourceinfo_t *si, int parc, char *parv[])
@@ -250,18 +250,13 @@ static mowgli_node_t *unreal_next_matching_ban(channel_t *c, user_t *u, int type
 {
 	chanban_t *cb;
 	mowgli_node_t *n;
-	char hostbuf[NICKLEN+USERLEN+HOSTLEN];
-	char realbuf[NICKLEN+USERLEN+HOSTLEN];
-	char ipbuf[NICKLEN+USERLEN+HOSTLEN];
+	const usermasks_t *um;
 	char *p;
 	bool matched;
 	int exttype;
 	channel_t *target_c;
 
-	snprintf(hostbuf, sizeof hostbuf, "%s!%s@%s", u->nick, u->user, u->vhost);
-	snprintf(realbuf, sizeof realbuf, "%s!%s@%s", u->nick, u->user, u->host);
-	/* will be nick!user@ if ip unknown, doesn't matter */
-	snprintf(ipbuf, sizeof ipbuf, "%s!%s@%s", u->nick, u->user, u->ip);
+	um = user_masks(u);
 
 	MOWGLI_ITER_FOREACH(n, first)
 	{
@@ -270,7 +265,7 @@ static mowgli_node_t *unreal_next_matching_ban(channel_t *c, user_t *u, int type
 		if (cb->type != type)
 			continue;
 
-		if ((!match(cb->mask, hostbuf) || !match(cb->mask, realbuf) || !match(cb->mask, ipbuf)))
+		if ((!hostmatch(cb->matcher, um->vhost) || !hostmatch(cb->matcher, um->host) || !hostmatch(cb->matcher, um->ip)))
 			return n;
 		if (cb->mask[0] == '~')
 		{
@@ -303,7 +298,7 @@ static mowgli_node_t *unreal_next_matching_ban(channel_t *c, user_t *u, int type
 					matched = should_reg_umode(u);
 					break;
 				case 'q':
-					matched = !match(p, hostbuf) || !match(p, ipbuf);
+					matched = !match(p, um->vhost) || !match(p, um->ip);
 					break;
 				default:
 					continue;
@@ -1236,12 +1231,14 @@ static void unreal_user_mode(user_t *u, const char *changes)
 					{
 						strshare_unref(u->chost);
 						u->chost = strshare_get(u->vhost);
+						user_mask_changed(u);
 					}
 				}
 				else if (dir == MTYPE_DEL)
 				{
 					strshare_unref(u->vhost);
 					u->vhost = strshare_get(u->host);
+					user_mask_changed(u);
 				}
 				break;
 		}
@@ -1453,6 +1450,7 @@ static void m_sethost(sourceinfo_t *si, int parc, char *parv[])
 {
 	strshare_unref(si->su->vhost);
 	si->su->vhost = strshare_get(parv[0]);
+	user_mask_changed(si->su);
 }
 
 static void m_chghost(sourceinfo_t *si, int parc, char *parv[])
@@ -1464,6 +1462,7 @@ static void m_chghost(sourceinfo_t *si, int parc, char *parv[])
 
 	strshare_unref(u->vhost);
 	u->vhost = strshare_get(parv[1]);
+	user_mask_changed(u);
 }
 
 static void m_motd(sourceinfo_t *si, int parc, char *parv[])
@@ -180,10 +180,7 @@ static void p10_parse(char *line)
 				slog(LG_INFO, "p10_parse(): insufficient parameters for command %s", pcmd->token);
 				goto cleanup;
 			}
-			if (pcmd->handler)
-			{
-				pcmd->handler(si, parc, parv);
-			}
+			pcommand_exec(pcmd, si, parc, parv);
 		}
 	}
 
@@ -26,6 +26,57 @@
 #include "pmodule.h"
 #include "rfc1459.h"
 
+/* the line being parsed, for looking at in a core dump */
+static const char *coreLine;
+
+/*
+ * Every line gets the same sourceinfo, cleared in between, rather than a
+ * new one.  If a handler keeps a reference to it or hangs data off it,
+ * it is left to the handler and a new one is made for the next line.
+ */
+static sourceinfo_t *irc_parse_si;
+
+static sourceinfo_t *irc_parse_sourceinfo_get(void)
+{
+	sourceinfo_t *si;
+	object_t parent;
+
+	si = irc_parse_si;
+	irc_parse_si = NULL;
+
+	if (si == NULL)
+		si = sourceinfo_create();
+	else
+	{
+		parent = si->parent;
+		memset(si, 0, sizeof *si);
+		si->parent = parent;
+	}
+
+	return si;
+}
+
+static void irc_parse_sourceinfo_put(sourceinfo_t *si)
+{
+	if (irc_parse_si == NULL && object(si)->refcount == 1 &&
+			object(si)->nmetadata == 0 && object(si)->privatedata == NULL)
+		irc_parse_si = si;
+	else
+		object_unref(si);
+}
+
+/* finds the user or server a message came from */
+static void irc_parse_origin(sourceinfo_t *si, const char *origin)
+{
+	/* nicks cannot contain dots, and a SID is three characters
+	 * starting with a digit, so most prefixes need one lookup */
+	if (strchr(origin, '.') != NULL ||
+			(ircd->uses_uid && isdigit((unsigned char)*origin) && strlen(origin) == 3))
+		si->s = server_find(origin);
+	else if ((si->su = user_find(origin)) == NULL)
+		si->s = server_find(origin);
+}
+
 /* parses a standard 2.8.21 style IRC stream */
 void irc_parse(char *line)
 {
@@ -35,7 +86,7 @@ void irc_parse(char *line)
 	char *command = NULL;
 	char *message = NULL;
 	char *parv[MAXPARC + 1];
-	static char coreLine[BUFSIZE];
+	char *split[2] = { NULL, NULL };
 	int parc = 0;
 	unsigned int i;
 	pcommand_t *pcmd;
@@ -44,7 +95,7 @@ void irc_parse(char *line)
 	for (i = 0; i <= MAXPARC; i++)
 		parv[i] = NULL;
 
-	si = sourceinfo_create();
+	si = irc_parse_sourceinfo_get();
 	si->connection = curr_uplink->conn;
 	si->output_limit = MAX_IRC_OUTPUT_LINES;
 
@@ -58,15 +109,15 @@ void irc_parse(char *line)
 		if (*line == '\000')
 			goto cleanup;
 
-		/* copy the original line so we know what we crashed on */
-		memset((char *)&coreLine, '\0', BUFSIZE);
-		mowgli_strlcpy(coreLine, line, BUFSIZE);
+		coreLine = line;
 
-		slog(LG_RAWDATA, "-> %s", line);
+		if (log_level_enabled(LG_RAWDATA))
+			slog(LG_RAWDATA, "-> %s", line);
 
 		/* find the first space */
 		if ((pos = strchr(line, ' ')))
 		{
+			split[0] = pos;
 			*pos = '\0';
 			pos++;
 			/* if it starts with a : we have a prefix/origin
@@ -77,11 +128,11 @@ void irc_parse(char *line)
 			{
                         	origin = line + 1;
 
-				si->s = server_find(origin);
-				si->su = user_find(origin);
+				irc_parse_origin(si, origin);
 
 				if ((message = strchr(pos, ' ')))
 				{
+					split[1] = message;
 					*message = '\0';
 					message++;
 					command = pos;
@@ -118,15 +169,17 @@ void irc_parse(char *line)
                         slog(LG_DEBUG, "irc_parse(): got message from nonexistant user or server: %s", origin);
                         goto cleanup;
                 }
-		if (si->s == me.me)
-		{
-                        slog(LG_INFO, "irc_parse(): got message supposedly from myself %s: %s", si->s->name, coreLine);
-                        goto cleanup;
-		}
-		if (si->su != NULL && si->su->server == me.me)
+		if (si->s == me.me || (si->su != NULL && si->su->server == me.me))
 		{
-                        slog(LG_INFO, "irc_parse(): got message supposedly from my own client %s: %s", si->su->nick, coreLine);
-                        goto cleanup;
+			/* put the line back together for the log */
+			for (i = 0; i < 2; i++)
+				if (split[i] != NULL)
+					*split[i] = ' ';
+			if (si->s == me.me)
+				slog(LG_INFO, "irc_parse(): got message supposedly from myself %s: %s", si->s->name, line);
+			else
+				slog(LG_INFO, "irc_parse(): got message supposedly from my own client %s: %s", si->su->nick, line);
+			goto cleanup;
 		}
 		si->smu = si->su != NULL ? si->su->myuser : NULL;
 
@@ -171,15 +224,13 @@ void irc_parse(char *line)
 				slog(LG_INFO, "irc_parse(): insufficient parameters for command %s", pcmd->token);
 				goto cleanup;
 			}
-			if (pcmd->handler)
-			{
-				pcmd->handler(si, parc, parv);
-			}
+			pcommand_exec(pcmd, si, parc, parv);
 		}
 	}
 
 cleanup:
-	object_unref(si);
+	coreLine = NULL;
+	irc_parse_sourceinfo_put(si);
 }
 
 /* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
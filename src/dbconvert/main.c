@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2026 Atheme Development Group
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * dbconvert loads a database with one backend module and writes it back
+ * out with another, e.g. to migrate from OpenSEX to the binary backend or
+ * to roll back again:
+ *
+ *   dbconvert opensex binary services.db services.bdb
+ *   dbconvert binary opensex services.bdb services.db
+ */
+
+#include "atheme.h"
+#include "libathemecore.h"
+
+static bool db_saved_ok = false;
+
+static void handle_db_saved(void *unused)
+{
+	db_saved_ok = true;
+}
+
+static void handle_mdep(database_handle_t *db, const char *type)
+{
+	const char *modname = db_sread_word(db);
+
+	module_load(modname);
+}
+
+static database_module_t *load_backend(const char *name)
+{
+	char path[BUFSIZE];
+
+	snprintf(path, sizeof path, "backend/%s", name);
+
+	if (module_load(path) == NULL)
+	{
+		slog(LG_ERROR, "dbconvert: cannot load backend module %s", path);
+		exit(EXIT_FAILURE);
+	}
+
+	return db_mod;
+}
+
+int main(int argc, char *argv[])
+{
+	database_module_t *in_mod, *out_mod;
+
+	atheme_bootstrap();
+	atheme_init(argv[0], LOGDIR "/dbconvert.log");
+	atheme_setup();
+
+	if (argc < 5)
+	{
+		fprintf(stderr, "usage: %s <from backend> <to backend> <input file> <output file>\n", argv[0]);
+		fprintf(stderr, "  e.g. %s opensex binary services.db services.bdb\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (!strcmp(argv[1], argv[2]) && !strcmp(argv[3], argv[4]))
+	{
+		fprintf(stderr, "%s: refusing to convert %s onto itself\n", argv[0], argv[3]);
+		return EXIT_FAILURE;
+	}
+
+	runflags = RF_LIVE;
+	datadir = DATADIR;
+	strict_mode = false;
+	offline_mode = true;
+
+	/* sectioned databases must be read completely to be converted */
+	db_full_load = true;
+
+	slog(LG_INFO, "dbconvert is converting %s (%s) to %s (%s)", argv[3], argv[1], argv[4], argv[2]);
+
+	/* load the output backend first, so that MDEP rows naming it do not
+	 * switch db_mod away from the input backend while parsing.
+	 */
+	out_mod = load_backend(argv[2]);
+	in_mod = load_backend(argv[1]);
+
+	db_unregister_type_handler("MDEP");
+	db_register_type_handler("MDEP", handle_mdep);
+
+	slog(LG_INFO, "*** phase 1: demarshaling objects from %s datastore", argv[1]);
+
+	db_mod = in_mod;
+	runflags &= ~RF_LIVE;
+	db_load(argv[3]);
+	runflags |= RF_LIVE;
+
+	slog(LG_INFO, "*** phase 2: writing objects to %s datastore", argv[2]);
+
+	/* the backends only report a complete write, including the final
+	 * rename over the output file, through the db_saved hook.
+	 */
+	hook_add_db_saved(handle_db_saved);
+
+	db_mod = out_mod;
+	db_save(argv[4]);
+
+	if (!db_saved_ok)
+	{
+		fprintf(stderr, "%s: failed to write %s, see %s for details\n", argv[0], argv[4], LOGDIR "/dbconvert.log");
+		return EXIT_FAILURE;
+	}
+
+	slog(LG_INFO, "dbconvert: wrote %s", argv[4]);
+
+	return EXIT_SUCCESS;
+}
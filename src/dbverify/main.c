@@ -118,6 +118,9 @@ int main(int argc, char *argv[])
 	strict_mode = false;
 	offline_mode = true;
 
+	/* check all of the data, not only what services load at startup */
+	db_full_load = true;
+
 	slog(LG_INFO, "dbverify is operating on %s", filename);
 
 	m = module_load("backend/opensex");
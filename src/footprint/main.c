@@ -12,7 +12,7 @@ int main(int argc, char *argv[])
 {
 	unsigned int usercount = 0, channelcount = 0, membercount = 0,
 		klinecount = 0, qlinecount = 0, xlinecount = 0, regchannelcount = 0,
-		servercount = 0, regusercount = 0;
+		servercount = 0, regusercount = 0, metadatacount = 0;
 	unsigned int i;
 
 	/* make up some statistics */
@@ -31,6 +31,9 @@ int main(int argc, char *argv[])
 	/* 5% of users are probably misbehaving in some way... */
 	klinecount = xlinecount = qlinecount = (usercount * 0.05);
 
+	/* registered accounts and channels carry a handful of metadata */
+	metadatacount = (regusercount + regchannelcount) * 4;
+
 	printf("footprint for atheme %s (%s)\n", PACKAGE_VERSION, SERNO);
 
 	printf("\n* * *\n\n");
@@ -42,11 +45,17 @@ int main(int argc, char *argv[])
 	printf("%u registered channels\n", regchannelcount);
 	printf("%u memberships\n", membercount);
 	printf("%u klines / xlines / qlines\n", klinecount);
+	printf("%u metadata entries\n", metadatacount);
 
 	printf("\n* * *\n\n");
 
 	printf("sizeof object_t: %zu B\n", sizeof(object_t));
 
+	/* each entry also has a pointer in its object's vector; names are
+	 * shared and values vary, so neither is counted here */
+	printf("sizeof metadata_t: %zu B --> %zu KB\n", sizeof(metadata_t),
+			(metadatacount * (sizeof(metadata_t) + sizeof(metadata_t *))) / 1024);
+
 	printf("\n* * *\n\n");
 
 	printf("sizeof myentity_t: %zu B --> %zu KB\n", sizeof(myentity_t), (regusercount * sizeof(myentity_t)) / 1024);
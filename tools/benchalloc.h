@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2026 Atheme Development Group
+ * Rights to this code are as documented in doc/LICENSE.
+ *
+ * Allocation counting for the benchmarks.  Including this in one file of
+ * a tool replaces the C library's malloc(), calloc() and realloc() for
+ * the whole process, libathemecore included, with versions that count
+ * calls before handing them on; services themselves never pay for it.
+ * This only works with glibc; elsewhere bench_allocations() stays 0.
+ */
+
+#ifndef BENCHALLOC_H
+#define BENCHALLOC_H
+
+static unsigned long bench_allocs;
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+/* other threads allocate too, e.g. the OpenSEX reader thread */
+void *malloc(size_t size)
+{
+	__sync_fetch_and_add(&bench_allocs, 1);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	__sync_fetch_and_add(&bench_allocs, 1);
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	__sync_fetch_and_add(&bench_allocs, 1);
+	return __libc_realloc(ptr, size);
+}
+#endif
+
+static unsigned long bench_allocations(void)
+{
+	return __sync_fetch_and_add(&bench_allocs, 0);
+}
+
+#endif
+
+/* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
+ * vim:ts=8
+ * vim:sw=8
+ * vim:noexpandtab
+ */
@@ -28,42 +28,125 @@
  * ./createtestdb 500000 >atheme.db
  *
  * then start atheme-services with this atheme.db
+ *
+ * The shape of the database can be changed with:
+ *   -n count   nicknames per account (including the account name)
+ *   -m count   metadata entries per account
+ *   -M count   memos per account
+ *   -c count   registered channels
+ *   -a count   access entries per channel (including the founder)
+ *
+ * e.g. ./createtestdb -n 2 -m 4 -M 1 -c 50000 -a 10 500000 >atheme.db
  */
 
 #include	<stdio.h>
 #include	<time.h>
 #include	<stdlib.h>
+#include	<unistd.h>
+
+#define MUFLAGS "+C" /* MU_CRYPTPASS */
 
-#define MUFLAGS 0x100 /* MU_CRYPTPASS */
+#define FOUNDER_FLAGS "+AFRefiorstv"
+#define AOP_FLAGS "+AOiortv"
+
+/* entity UIDs as allocated by myentity_alloc_uid() */
+static const char *
+make_uid(int n)
+{
+	static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+	static char uid[10];
+	int i;
+
+	for (i = 8; i >= 0; i--)
+	{
+		uid[i] = digits[n % 36];
+		n /= 36;
+	}
+	uid[9] = '\0';
+
+	return uid;
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [-n nicks] [-m metadata] [-M memos] [-c channels] [-a chanacs] count\n", prog);
+	exit(1);
+}
 
 int
 main(int argc, char *argv[])
 {
-	int count, i;
+	int count, i, j, c;
+	int nicks = 1, metadata = 0, memos = 0, channels = 0, chanacs = 1;
 	char nick[20];
 	time_t now;
 
-	if (argc != 2)
+	while ((c = getopt(argc, argv, "n:m:M:c:a:")) != -1)
 	{
-		fprintf(stderr, "Usage: %s count\n", argv[0]);
-		return 1;
+		switch (c)
+		{
+		case 'n':
+			nicks = atoi(optarg);
+			break;
+		case 'm':
+			metadata = atoi(optarg);
+			break;
+		case 'M':
+			memos = atoi(optarg);
+			break;
+		case 'c':
+			channels = atoi(optarg);
+			break;
+		case 'a':
+			chanacs = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
 	}
 
-	count = atoi(argv[1]);
+	if (argc - optind != 1)
+		usage(argv[0]);
+
+	count = atoi(argv[optind]);
+	if (count <= 0 && channels > 0)
+	{
+		fprintf(stderr, "%s: channels need accounts to be registered to\n", argv[0]);
+		return 1;
+	}
 
 	now = time(NULL);
 
-	printf("# Test database with %d accounts\n", count);
-	printf("DBV 4\n");
-	printf("CF +vVhHoOtsriRfAb\n");
+	printf("# Test database with %d accounts, %d channels\n", count, channels);
+	printf("DBV 12\n");
+	if (count > 0)
+		printf("LUID %s\n", make_uid(count - 1));
+	printf("CF +AFORVbefhiorstv\n");
 	for (i = 0; i < count; i++)
 	{
 		snprintf(nick, sizeof nick, "a%010d", i);
-		printf("MU %s * noemail %lu %lu 0 0 0 %d\n", nick,
+		printf("MU %s %s * noemail %lu %lu %s default\n", make_uid(i), nick,
 				(unsigned long)now,
 				(unsigned long)now, MUFLAGS);
+		for (j = 0; j < metadata; j++)
+			printf("MDU %s private:test:%d value %d of account %d\n", nick, j, j, i);
+		for (j = 0; j < memos; j++)
+			printf("ME %s a%010d %lu 0 test memo %d for account %d\n", nick, (i + j + 1) % count,
+					(unsigned long)now, j, i);
 		printf("MN %s %s %lu %lu\n", nick, nick, (unsigned long)now,
 				(unsigned long)now);
+		for (j = 1; j < nicks; j++)
+			printf("MN %s %s_%d %lu %lu\n", nick, nick, j, (unsigned long)now,
+					(unsigned long)now);
+	}
+
+	for (i = 0; i < channels; i++)
+	{
+		printf("MC #c%010d %lu %lu +v 0 0 0\n", i, (unsigned long)now, (unsigned long)now);
+		for (j = 0; j < chanacs && j < count; j++)
+			printf("CA #c%010d a%010d %s %lu *\n", i, (i + j) % count,
+					j == 0 ? FOUNDER_FLAGS : AOP_FLAGS, (unsigned long)now);
 	}
 
 	return 0;
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2026 Atheme Development Group
+ * Rights to this code are as documented in doc/LICENSE.
+ *
+ * dbbench loads a database through a backend module and writes it out
+ * again, reporting how long each phase took and what it cost, one JSON
+ * object per line so that results can be compared across releases:
+ *
+ *   ../createtestdb/createtestdb -n 2 -m 4 -c 50000 -a 10 500000 >bench.db
+ *   ./dbbench -d . bench.db
+ *
+ * Like dbverify, it loads the installed modules.  Allocations are calls
+ * to malloc() and friends from anywhere in the process, block heap
+ * growth included; see ../benchalloc.h.
+ */
+
+#include "atheme.h"
+#include "libathemecore.h"
+#include "../benchalloc.h"
+
+#include <sys/resource.h>
+
+typedef struct {
+	struct timeval start;
+	unsigned int rows;
+	unsigned long allocs;
+} bench_mark_t;
+
+static void handle_mdep(database_handle_t *db, const char *type)
+{
+	const char *modname = db_sread_word(db);
+
+	module_load(modname);
+}
+
+static void bench_start(bench_mark_t *m, unsigned int rows)
+{
+	m->rows = rows;
+	m->allocs = bench_allocations();
+	gettimeofday(&m->start, NULL);
+}
+
+static void bench_report(bench_mark_t *m, const char *backend, const char *phase, const char *file, unsigned int rows)
+{
+	struct timeval now, tv;
+	struct rusage ru;
+	unsigned long ms;
+
+	gettimeofday(&now, NULL);
+	timersub(&now, &m->start, &tv);
+	ms = tv.tv_sec * 1000 + tv.tv_usec / 1000;
+
+	getrusage(RUSAGE_SELF, &ru);
+	rows -= m->rows;
+
+	/* ru_maxrss is in kilobytes, except on some BSDs */
+	printf("{\"version\": \"%s\", \"backend\": \"%s\", \"phase\": \"%s\", \"file\": \"%s\", "
+			"\"ms\": %lu, \"rows\": %u, \"rows_per_sec\": %lu, \"peak_rss_kb\": %ld, \"allocs\": %lu}\n",
+			PACKAGE_VERSION, backend, phase, file, ms, rows,
+			ms > 0 ? (unsigned long)((unsigned long long)rows * 1000 / ms) : (unsigned long)rows,
+			(long)ru.ru_maxrss, bench_allocations() - m->allocs);
+	fflush(stdout);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-b backend] [-d datadir] [-o output] [-s saves] <database>\n", prog);
+	fprintf(stderr, "  e.g. %s -b opensex -s 3 bench.db\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *backend = "opensex", *output = NULL, *input;
+	char path[BUFSIZE], outbuf[BUFSIZE];
+	unsigned int saves = 1, i;
+	bench_mark_t mark;
+	int c;
+
+	atheme_bootstrap();
+	atheme_init(argv[0], LOGDIR "/dbbench.log");
+	atheme_setup();
+
+	runflags = RF_LIVE;
+	datadir = DATADIR;
+	strict_mode = false;
+	offline_mode = true;
+
+	/* measure loading all of a sectioned database */
+	db_full_load = true;
+
+	while ((c = getopt(argc, argv, "b:d:o:s:")) != -1)
+	{
+		switch (c)
+		{
+		case 'b':
+			backend = optarg;
+			break;
+		case 'd':
+			datadir = optarg;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 's':
+			saves = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (argc - optind != 1)
+		usage(argv[0]);
+
+	input = argv[optind];
+	if (output == NULL)
+	{
+		snprintf(outbuf, sizeof outbuf, "%s.out", input);
+		output = outbuf;
+	}
+
+	snprintf(path, sizeof path, "backend/%s", backend);
+	if (module_load(path) == NULL)
+	{
+		fprintf(stderr, "%s: cannot load backend module %s\n", argv[0], path);
+		return EXIT_FAILURE;
+	}
+
+	db_unregister_type_handler("MDEP");
+	db_register_type_handler("MDEP", handle_mdep);
+
+	bench_start(&mark, db_rows_read);
+	runflags &= ~RF_LIVE;
+	db_load(input);
+	runflags |= RF_LIVE;
+	bench_report(&mark, backend, "load", input, db_rows_read);
+
+	for (i = 0; i < saves; i++)
+	{
+		bench_start(&mark, db_rows_written);
+		db_save((void *)output);
+		bench_report(&mark, backend, "save", output, db_rows_written);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
+ * vim:ts=8
+ * vim:sw=8
+ * vim:noexpandtab
+ */
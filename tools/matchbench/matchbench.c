@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2026 Atheme Development Group
+ * Rights to this code are as documented in doc/LICENSE.
+ *
+ * matchbench matches a set of generated ban-style masks against a set of
+ * generated nick!user@host addresses, once with match() and match_cidr()
+ * and once with the prepared hostmatch_t objects that bans, access
+ * entries and K-lines keep, and reports the time taken by each, one JSON
+ * object per line like dbbench:
+ *
+ *   ./matchbench -m 200 -u 5000 -r 5
+ *
+ * It also counts the matches found both ways and fails if they differ.
+ */
+
+#include "atheme.h"
+#include "libathemecore.h"
+
+typedef struct {
+	const char *name;
+	struct timeval start;
+} bench_mark_t;
+
+static const char *words[] = {
+	"alpha", "Bravo", "charlie", "DELTA", "echo", "foxtrot", "golf",
+	"hotel", "india", "juliet", "kilo", "lima", "mike", "november",
+};
+
+#define NWORDS (sizeof words / sizeof words[0])
+
+static const char *word(void)
+{
+	return words[rand() % NWORDS];
+}
+
+static char *make_address(void)
+{
+	char buf[BUFSIZE];
+
+	snprintf(buf, sizeof buf, "%s%d!~%s@%d.%d.%d.%d", word(), rand() % 100, word(),
+			rand() % 4, rand() % 256, rand() % 256, rand() % 256);
+	return sstrdup(buf);
+}
+
+/* roughly the shapes bans and K-lines come in */
+static char *make_mask(void)
+{
+	char buf[BUFSIZE];
+
+	switch (rand() % 8)
+	{
+	case 0:
+		snprintf(buf, sizeof buf, "*!*@%d.%d.%d.%d", rand() % 4, rand() % 256, rand() % 256, rand() % 256);
+		break;
+	case 1:
+		snprintf(buf, sizeof buf, "*!*@%d.%d.*", rand() % 4, rand() % 256);
+		break;
+	case 2:
+		snprintf(buf, sizeof buf, "%s*!*@*", word());
+		break;
+	case 3:
+		snprintf(buf, sizeof buf, "*!~%s@*", word());
+		break;
+	case 4:
+		snprintf(buf, sizeof buf, "*%s*!*@*", word());
+		break;
+	case 5:
+		snprintf(buf, sizeof buf, "*!*@%d.%d.0.0/16", rand() % 4, rand() % 256);
+		break;
+	case 6:
+		snprintf(buf, sizeof buf, "%s%d!*@*", word(), rand() % 100);
+		break;
+	default:
+		snprintf(buf, sizeof buf, "%s?%d!*@*", word(), rand() % 10);
+		break;
+	}
+
+	return sstrdup(buf);
+}
+
+static void bench_start(bench_mark_t *m, const char *name)
+{
+	m->name = name;
+	gettimeofday(&m->start, NULL);
+}
+
+static void bench_report(bench_mark_t *m, unsigned int masks, unsigned int addresses, unsigned long checks, unsigned long matches)
+{
+	struct timeval now, tv;
+	unsigned long us;
+
+	gettimeofday(&now, NULL);
+	timersub(&now, &m->start, &tv);
+	us = tv.tv_sec * 1000000 + tv.tv_usec;
+
+	printf("{\"version\": \"%s\", \"matcher\": \"%s\", \"masks\": %u, \"addresses\": %u, "
+			"\"us\": %lu, \"checks\": %lu, \"ns_per_check\": %lu, \"matches\": %lu}\n",
+			PACKAGE_VERSION, m->name, masks, addresses, us, checks,
+			checks > 0 ? (unsigned long)((unsigned long long)us * 1000 / checks) : 0UL, matches);
+	fflush(stdout);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-m masks] [-u addresses] [-r rounds] [-s seed]\n", prog);
+	fprintf(stderr, "  e.g. %s -m 200 -u 5000 -r 5\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int nmasks = 200, naddrs = 5000, rounds = 5, seed = 1, i, j, r;
+	unsigned long checks, plain, compiled;
+	char **masks, **addrs;
+	hostmatch_t **matchers;
+	bench_mark_t mark;
+	int c;
+
+	while ((c = getopt(argc, argv, "m:u:r:s:")) != -1)
+	{
+		switch (c)
+		{
+		case 'm':
+			nmasks = atoi(optarg);
+			break;
+		case 'u':
+			naddrs = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (argc != optind || nmasks == 0 || naddrs == 0)
+		usage(argv[0]);
+
+	srand(seed);
+
+	masks = smalloc(nmasks * sizeof(char *));
+	matchers = smalloc(nmasks * sizeof(hostmatch_t *));
+	addrs = smalloc(naddrs * sizeof(char *));
+
+	for (i = 0; i < nmasks; i++)
+		masks[i] = make_mask();
+	for (i = 0; i < naddrs; i++)
+		addrs[i] = make_address();
+
+	checks = (unsigned long)nmasks * naddrs * rounds;
+
+	bench_start(&mark, "match");
+	for (r = 0, plain = 0; r < rounds; r++)
+		for (i = 0; i < nmasks; i++)
+			for (j = 0; j < naddrs; j++)
+				if (!match(masks[i], addrs[j]) || !match_cidr(masks[i], addrs[j]))
+					plain++;
+	bench_report(&mark, nmasks, naddrs, checks, plain);
+
+	/* preparing the masks is part of the cost */
+	bench_start(&mark, "hostmatch");
+	for (i = 0; i < nmasks; i++)
+		matchers[i] = hostmatch_create(masks[i]);
+	for (r = 0, compiled = 0; r < rounds; r++)
+		for (i = 0; i < nmasks; i++)
+			for (j = 0; j < naddrs; j++)
+				if (!hostmatch(matchers[i], addrs[j]) || !hostmatch_cidr(matchers[i], addrs[j]))
+					compiled++;
+	bench_report(&mark, nmasks, naddrs, checks, compiled);
+
+	if (plain != compiled)
+	{
+		fprintf(stderr, "%s: match() found %lu matches but hostmatch() found %lu\n", argv[0], plain, compiled);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < nmasks; i++)
+	{
+		hostmatch_destroy(matchers[i]);
+		free(masks[i]);
+	}
+	for (i = 0; i < naddrs; i++)
+		free(addrs[i]);
+	free(matchers);
+	free(masks);
+	free(addrs);
+
+	return EXIT_SUCCESS;
+}
+
+/* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
+ * vim:ts=8
+ * vim:sw=8
+ * vim:noexpandtab
+ */
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2026 Atheme Development Group
+ * Rights to this code are as documented in doc/LICENSE.
+ *
+ * parsebench feeds a generated stream of server-to-server lines through
+ * the RFC1459 parser and reports how many lines it parsed per second,
+ * one JSON object per line like dbbench:
+ *
+ *   ./parsebench -u 10000 -l 1000000 -r 5
+ *
+ * The lines come from a few thousand users and one server, with prefixes
+ * by UID, SID, nick and server name, and go to handlers that only count
+ * them, so it is the parser and the source lookups that are measured.
+ * Like dbbench, it loads the installed transport module and counts
+ * allocations with ../benchalloc.h.
+ */
+
+#include "atheme.h"
+#include "libathemecore.h"
+#include "../benchalloc.h"
+#include "uplink.h"
+#include "pmodule.h"
+
+typedef struct {
+	struct timeval start;
+	unsigned long allocs;
+} bench_mark_t;
+
+static ircd_t bench_ircd = {
+	.ircdname = "parsebench",
+	.tldprefix = "$$",
+	.uses_uid = true,
+};
+
+static uplink_t bench_uplink;
+static unsigned long handled;
+
+static void m_count(sourceinfo_t *si, int parc, char *parv[])
+{
+	handled++;
+}
+
+static void bench_start(bench_mark_t *m)
+{
+	m->allocs = bench_allocations();
+	gettimeofday(&m->start, NULL);
+}
+
+static void bench_report(bench_mark_t *m, unsigned int users, unsigned long lines)
+{
+	struct timeval now, tv;
+	unsigned long us;
+
+	gettimeofday(&now, NULL);
+	timersub(&now, &m->start, &tv);
+	us = tv.tv_sec * 1000000 + tv.tv_usec;
+
+	printf("{\"version\": \"%s\", \"users\": %u, \"lines\": %lu, \"us\": %lu, "
+			"\"lines_per_sec\": %lu, \"handled\": %lu, \"allocs\": %lu}\n",
+			PACKAGE_VERSION, users, lines, us,
+			us > 0 ? (unsigned long)((unsigned long long)lines * 1000000 / us) : lines,
+			handled, bench_allocations() - m->allocs);
+	fflush(stdout);
+}
+
+static void make_line(char *buf, size_t len, user_t **users, unsigned int nusers)
+{
+	user_t *u = users[rand() % nusers];
+
+	switch (rand() % 8)
+	{
+	case 0:
+	case 1:
+	case 2:
+		snprintf(buf, len, ":%s PRIVMSG #chan%d :hello there, this is line %d", u->uid, rand() % 100, rand());
+		break;
+	case 3:
+		snprintf(buf, len, ":%s NOTICE %s :ping %d", u->uid, users[rand() % nusers]->uid, rand());
+		break;
+	case 4:
+		snprintf(buf, len, ":%s AWAY :gone since %d", u->nick, rand());
+		break;
+	case 5:
+		snprintf(buf, len, ":00A PING 00A :%s", me.numeric);
+		break;
+	case 6:
+		snprintf(buf, len, ":irc.parsebench.test NOTICE * :*** Notice -- %d", rand());
+		break;
+	default:
+		snprintf(buf, len, "PING :irc.parsebench.test");
+		break;
+	}
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-u users] [-l lines] [-r rounds] [-s seed]\n", prog);
+	fprintf(stderr, "  e.g. %s -u 10000 -l 1000000 -r 5\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int nusers = 10000, rounds = 5, seed = 1, i, r;
+	unsigned long nlines = 1000000, n;
+	char buf[BUFSIZE], nick[NICKLEN], uid[IDLEN];
+	char **lines;
+	user_t **users;
+	server_t *s;
+	bench_mark_t mark;
+	int c;
+
+	atheme_bootstrap();
+	atheme_init(argv[0], LOGDIR "/parsebench.log");
+	atheme_setup();
+
+	runflags = RF_LIVE;
+	offline_mode = true;
+
+	while ((c = getopt(argc, argv, "u:l:r:s:")) != -1)
+	{
+		switch (c)
+		{
+		case 'u':
+			nusers = atoi(optarg);
+			break;
+		case 'l':
+			nlines = atol(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (argc != optind || nusers == 0 || nlines == 0)
+		usage(argv[0]);
+
+	if (module_load("transport/rfc1459") == NULL)
+	{
+		fprintf(stderr, "%s: cannot load transport/rfc1459\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	srand(seed);
+
+	/* a network of one server with us on the other side; nothing is
+	 * ever sent, we are not connected */
+	ircd = &bench_ircd;
+	curr_uplink = &bench_uplink;
+	me.name = sstrdup("services.parsebench.test");
+	me.numeric = sstrdup("00X");
+	me.actual = sstrdup("irc.parsebench.test");
+	me.me = server_add(me.name, 0, NULL, me.numeric, "parsebench");
+	s = server_add(me.actual, 1, me.me, "00A", "parsebench uplink");
+	me.recvsvr = true;
+
+	users = smalloc(nusers * sizeof(user_t *));
+	for (i = 0; i < nusers; i++)
+	{
+		snprintf(nick, sizeof nick, "user%u", i);
+		snprintf(uid, sizeof uid, "00A%06X", i);
+		users[i] = user_add(nick, "~bench", "bench.example", NULL, "192.0.2.1", uid, "parsebench user", s, CURRTIME);
+	}
+
+	pcommand_add("PRIVMSG", m_count, 2, MSRC_USER | MSRC_SERVER);
+	pcommand_add("NOTICE", m_count, 2, MSRC_USER | MSRC_SERVER);
+	pcommand_add("AWAY", m_count, 0, MSRC_USER);
+	pcommand_add("PING", m_count, 1, MSRC_USER | MSRC_SERVER);
+
+	lines = smalloc(nlines * sizeof(char *));
+	for (n = 0; n < nlines; n++)
+	{
+		make_line(buf, sizeof buf, users, nusers);
+		lines[n] = sstrdup(buf);
+	}
+
+	/* the parser sets itself up on its first line; after that,
+	 * parsing should not allocate at all */
+	mowgli_strlcpy(buf, lines[0], sizeof buf);
+	parse(buf);
+
+	/* parse() cuts lines up, so each round parses copies */
+	for (r = 0; r < rounds; r++)
+	{
+		handled = 0;
+		bench_start(&mark);
+		for (n = 0; n < nlines; n++)
+		{
+			mowgli_strlcpy(buf, lines[n], sizeof buf);
+			parse(buf);
+		}
+		bench_report(&mark, nusers, nlines);
+	}
+
+	if (handled != nlines)
+	{
+		fprintf(stderr, "%s: parsed %lu lines but only %lu reached a handler\n", argv[0], nlines, handled);
+		return EXIT_FAILURE;
+	}
+
+	for (n = 0; n < nlines; n++)
+		free(lines[n]);
+	free(lines);
+	free(users);
+
+	return EXIT_SUCCESS;
+}
+
+/* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
+ * vim:ts=8
+ * vim:sw=8
+ * vim:noexpandtab
+ */